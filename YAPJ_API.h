@@ -0,0 +1,112 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// C interface for other native plugins to exchange documents with YAPJ without
+// stringifying them. Obtain the function table with:
+//
+//   Windows: GetProcAddress(GetModuleHandleA("YAPJ.dll"), "YAPJ_GetAPI")
+//   Linux:   dlsym(dlopen("YAPJ.so", RTLD_NOW | RTLD_NOLOAD), "YAPJ_GetAPI")
+//
+//   const yapj_api *api = YAPJ_GetAPI(YAPJ_API_VERSION);
+//
+// All functions must be called from the server thread. Strings are UTF-8 and are
+// not transcoded. Nodes returned by create_* and take are owned documents: they
+// must be either released to a script handle, moved into another document with
+// set_member/append, or destroyed. Nodes returned by resolve, get_member and
+// get_element are views into an existing document and must not be destroyed.
+
+#ifndef YAPJ_API_H_
+#define YAPJ_API_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define YAPJ_API_VERSION 1
+
+#if defined _WIN32
+  #define YAPJ_API_CALL __stdcall
+#else
+  #define YAPJ_API_CALL
+#endif
+
+typedef struct yapj_node yapj_node;
+
+// Same values as JsonNodeType in YAPJ.inc
+enum yapj_node_type {
+  YAPJ_NODE_NULL = 64,
+  YAPJ_NODE_BOOLEAN,
+  YAPJ_NODE_INT,
+  YAPJ_NODE_FLOAT,
+  YAPJ_NODE_STRING,
+  YAPJ_NODE_OBJECT,
+  YAPJ_NODE_ARRAY
+};
+
+typedef struct yapj_api {
+  uint32_t version;    // YAPJ_API_VERSION the table was built for
+  uint32_t table_size; // sizeof(yapj_api), functions may be appended within one version
+
+  // Handles. handle is a JsonNode value passed by script
+  yapj_node *(*resolve)(int32_t handle);           // view of handle's node, NULL if handle is invalid
+  yapj_node *(*resolve_mutable)(int32_t handle);   // same, and marks node as changed. Do not keep the view after returning to script
+  yapj_node *(*take)(int32_t handle);              // takes ownership of handle's node, the handle becomes invalid
+  int32_t (*release)(yapj_node *document);         // gives ownership of document to a new JsonNode handle
+
+  // Construction, every function returns an owned document or NULL on failure
+  yapj_node *(*create_null)(void);
+  yapj_node *(*create_bool)(int value);
+  yapj_node *(*create_int)(int64_t value);
+  yapj_node *(*create_float)(double value);
+  yapj_node *(*create_string)(const char *value, size_t length);
+  yapj_node *(*create_object)(void);
+  yapj_node *(*create_array)(void);
+  yapj_node *(*clone)(const yapj_node *node);
+  void (*destroy)(yapj_node *document);
+
+  // Reading, functions returning int return 1 on success and 0 on type mismatch
+  int (*type)(const yapj_node *node);
+  int (*get_bool)(const yapj_node *node, int *value);
+  int (*get_int)(const yapj_node *node, int64_t *value);
+  int (*get_float)(const yapj_node *node, double *value);
+  int (*get_string)(const yapj_node *node, const char **value, size_t *length); // valid until node changes
+  size_t (*size)(const yapj_node *node);                                          // members of object, elements of array
+  yapj_node *(*get_member)(yapj_node *object, const char *key, size_t key_length);
+  int (*member_at)(yapj_node *object, size_t index, const char **key, size_t *key_length, yapj_node **value);
+  yapj_node *(*get_element)(yapj_node *array, size_t index);
+
+  // Writing, value must be an owned document; it is moved into container and destroyed
+  int (*set_member)(yapj_node *object, const char *key, size_t key_length, yapj_node *value);
+  int (*append)(yapj_node *array, yapj_node *value);
+} yapj_api;
+
+// Returns function table compatible with version, or NULL if this build does not provide it
+typedef const yapj_api *(YAPJ_API_CALL *yapj_get_api_t)(uint32_t version);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // YAPJ_API_H_
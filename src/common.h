@@ -27,6 +27,7 @@
 #include <fstream>
 #include <chrono>
 #include <unordered_set>
+#include <optional>
 
 // Third-party libraries
 #include "json/single_include/nlohmann/json.hpp"
@@ -37,5 +38,13 @@ typedef nlohmann::ordered_json *node_ptr_t;
 typedef cell node_ptr_result_t;
 typedef cell call_result_t;
 typedef cell node_type_t;
+typedef const class json_fields *layout_ptr_t;
+typedef class json_schema *validator_ptr_t;
+typedef class json_log *log_ptr_t;
+typedef class json_lines *lines_ptr_t;
+typedef class json_index *index_ptr_t;
+typedef class json_persistent *snapshot_ptr_t;
+typedef class json_template *template_ptr_t;
+typedef class json_stringifier *cursor_ptr_t;
 
 #include "../YAPJ.inc"
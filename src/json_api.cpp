@@ -0,0 +1,169 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "script.h"
+#include "../YAPJ_API.h"
+
+using json = nlohmann::ordered_json;
+
+static json *to_json(yapj_node *node) {
+  return reinterpret_cast<json *>(node);
+}
+
+static const json *to_json(const yapj_node *node) {
+  return reinterpret_cast<const json *>(node);
+}
+
+static yapj_node *to_node(json *value) {
+  return reinterpret_cast<yapj_node *>(value);
+}
+
+// exceptions must not cross the C boundary
+template <typename F>
+static auto guarded(F func, decltype(func()) fallback) noexcept {
+  try {
+    return func();
+  } catch (...) {
+    return fallback;
+  }
+}
+
+template <typename T>
+static yapj_node *create(T value) {
+  return guarded([&] { return to_node(new json(std::move(value))); }, nullptr);
+}
+
+static const yapj_api api_v1 = {
+    YAPJ_API_VERSION,
+    sizeof(yapj_api),
+
+    [](int32_t handle) { return to_node(script::internal_JSON_Resolve(handle, false)); },
+    [](int32_t handle) { return to_node(script::internal_JSON_Resolve(handle, true)); },
+    [](int32_t handle) { return to_node(script::internal_JSON_Take(handle)); },
+    [](yapj_node *document) -> int32_t {
+      return document != nullptr ? script::internal_JSON_Register(to_json(document)) : JSON_INVALID_NODE;
+    },
+
+    []() { return create(json()); },
+    [](int value) { return create(json(value != 0)); },
+    [](int64_t value) { return create(json(value)); },
+    [](double value) { return create(json(value)); },
+    [](const char *value, size_t length) { return create(json(value != nullptr ? std::string(value, length) : std::string())); },
+    []() { return create(json::object()); },
+    []() { return create(json::array()); },
+    [](const yapj_node *node) { return create(json(*to_json(node))); },
+    [](yapj_node *document) { delete to_json(document); },
+
+    [](const yapj_node *node) -> int {
+      switch (to_json(node)->type()) {
+      case json::value_t::null:return YAPJ_NODE_NULL;
+      case json::value_t::boolean:return YAPJ_NODE_BOOLEAN;
+      case json::value_t::number_integer:
+      case json::value_t::number_unsigned:return YAPJ_NODE_INT;
+      case json::value_t::number_float:return YAPJ_NODE_FLOAT;
+      case json::value_t::string:return YAPJ_NODE_STRING;
+      case json::value_t::object:return YAPJ_NODE_OBJECT;
+      case json::value_t::array:return YAPJ_NODE_ARRAY;
+      default:return JSON_NODE_MAX;
+      }
+    },
+    [](const yapj_node *node, int *value) -> int {
+      if (!to_json(node)->is_boolean())
+        return 0;
+      *value = to_json(node)->get<bool>();
+      return 1;
+    },
+    [](const yapj_node *node, int64_t *value) -> int {
+      if (!to_json(node)->is_number())
+        return 0;
+      *value = to_json(node)->get<int64_t>();
+      return 1;
+    },
+    [](const yapj_node *node, double *value) -> int {
+      if (!to_json(node)->is_number())
+        return 0;
+      *value = to_json(node)->get<double>();
+      return 1;
+    },
+    [](const yapj_node *node, const char **value, size_t *length) -> int {
+      if (!to_json(node)->is_string())
+        return 0;
+      auto &string = to_json(node)->get_ref<const json::string_t &>();
+      *value = string.data();
+      *length = string.size();
+      return 1;
+    },
+    [](const yapj_node *node) -> size_t {
+      auto value = to_json(node);
+      return value->is_object() || value->is_array() ? value->size() : 0;
+    },
+    [](yapj_node *object, const char *key, size_t key_length) -> yapj_node * {
+      return guarded([&]() -> yapj_node * {
+        auto value = to_json(object);
+        if (!value->is_object())
+          return nullptr;
+        auto member = value->find(std::string(key, key_length));
+        return member != value->end() ? to_node(&*member) : nullptr;
+      }, nullptr);
+    },
+    [](yapj_node *object, size_t index, const char **key, size_t *key_length, yapj_node **value) -> int {
+      auto members = to_json(object);
+      if (!members->is_object() || index >= members->size())
+        return 0;
+      auto &member = *(members->get_ref<json::object_t &>().begin() + index);
+      *key = member.first.data();
+      *key_length = member.first.size();
+      *value = to_node(&member.second);
+      return 1;
+    },
+    [](yapj_node *array, size_t index) -> yapj_node * {
+      auto value = to_json(array);
+      if (!value->is_array() || index >= value->size())
+        return nullptr;
+      return to_node(&(*value)[index]);
+    },
+
+    [](yapj_node *object, const char *key, size_t key_length, yapj_node *value) -> int {
+      return guarded([&] {
+        auto target = to_json(object);
+        if (!target->is_object() || value == nullptr || to_json(value) == target)
+          return 0;
+        (*target)[std::string(key, key_length)] = std::move(*to_json(value));
+        delete to_json(value);
+        return 1;
+      }, 0);
+    },
+    [](yapj_node *array, yapj_node *value) -> int {
+      return guarded([&] {
+        auto target = to_json(array);
+        if (!target->is_array() || value == nullptr || to_json(value) == target)
+          return 0;
+        target->emplace_back(std::move(*to_json(value)));
+        delete to_json(value);
+        return 1;
+      }, 0);
+    },
+};
+
+PLUGIN_EXPORT const yapj_api *PLUGIN_CALL YAPJ_GetAPI(uint32_t version) {
+  return version == YAPJ_API_VERSION ? &api_v1 : nullptr;
+}
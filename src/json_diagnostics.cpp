@@ -0,0 +1,42 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "json_diagnostics.h"
+
+bool json_diagnostics::call_site::allow(uint32_t &dropped) {
+  dropped = 0;
+  if (per_second_limit == 0)
+    return true;
+  auto now = std::chrono::steady_clock::now();
+  if (now - window_start >= std::chrono::seconds(1)) {
+    window_start = now;
+    emitted = 0;
+  }
+  if (emitted >= per_second_limit) {
+    ++suppressed;
+    return false;
+  }
+  ++emitted;
+  dropped = suppressed;
+  suppressed = 0;
+  return true;
+}
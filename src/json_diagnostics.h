@@ -0,0 +1,53 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "common.h"
+#include <chrono>
+
+/**
+ * Runtime control of plugin diagnostics. Every logging call site owns a call_site which
+ * lets through at most per_second_limit messages per second; the rest are counted and
+ * reported as one line once the site logs again. Level and rate are checked before any
+ * message is formatted, so disabled diagnostics cost a comparison.
+ */
+class json_diagnostics {
+public:
+  class call_site {
+    std::chrono::steady_clock::time_point window_start;
+    uint32_t emitted{0};
+    uint32_t suppressed{0};
+  public:
+    /**
+     * @brief Checks rate limit of call site
+     * @param dropped Set to count of messages suppressed since last allowed one
+     * @return true if message may be logged
+     */
+    bool allow(uint32_t &dropped);
+  };
+
+  static inline JsonLogLevel current_level{JSON_LOG_LEVEL_WARNING};
+  static inline uint32_t per_second_limit{10}; // 0 disables rate limiting
+
+  static bool enabled(JsonLogLevel message_level) { return message_level <= current_level; }
+};
@@ -0,0 +1,107 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "json_fields.h"
+#include "iconvlite.hpp"
+
+namespace {
+std::unordered_map<std::string, json_fields> parsed_specs;
+}
+
+const json_fields *json_fields::get(const std::string &spec) {
+  if (auto cached = parsed_specs.find(spec); cached != parsed_specs.cend())
+    return &cached->second;
+  auto fields = parse(spec);
+  if (!fields)
+    return nullptr;
+  return &parsed_specs.emplace(spec, std::move(*fields)).first->second;
+}
+
+json_fields::field_type json_fields::argument_type(size_t index) const {
+  for (const auto &item : fields) {
+    if (item.type == field_type::padding)
+      continue;
+    if (index-- == 0)
+      return item.type;
+  }
+  return field_type::padding;
+}
+
+std::optional<json_fields> json_fields::parse(const std::string &spec) {
+  json_fields result;
+  size_t pos = 0;
+  auto skip_spaces = [&] {
+    while (pos < spec.size() && std::isspace(static_cast<unsigned char>(spec[pos])))
+      ++pos;
+  };
+  for (skip_spaces(); pos < spec.size(); skip_spaces()) {
+    field item{};
+    item.length = 1;
+    switch (spec[pos++]) {
+    case 'i':
+    case 'd':item.type = field_type::integer;
+      break;
+    case 'f':item.type = field_type::floating;
+      break;
+    case 'b':item.type = field_type::boolean;
+      break;
+    case 's':item.type = field_type::string;
+      break;
+    case 'j':item.type = field_type::node;
+      break;
+    case 'x':item.type = field_type::padding;
+      break;
+    default:return std::nullopt;
+    }
+    if (pos < spec.size() && spec[pos] == '[') {
+      auto end = spec.find(']', ++pos);
+      if (end == std::string::npos || end == pos)
+        return std::nullopt;
+      item.length = 0;
+      for (; pos < end; ++pos) {
+        if (!std::isdigit(static_cast<unsigned char>(spec[pos])))
+          return std::nullopt;
+        item.length = item.length * 10 + (spec[pos] - '0');
+      }
+      ++pos;
+      if (item.length == 0 || (item.type != field_type::string && item.type != field_type::padding))
+        return std::nullopt;
+    } else if (item.type == field_type::string) {
+      return std::nullopt;
+    }
+    if (item.type != field_type::padding) {
+      if (pos >= spec.size() || spec[pos] != ':')
+        return std::nullopt;
+      auto begin = ++pos;
+      while (pos < spec.size() && !std::isspace(static_cast<unsigned char>(spec[pos])))
+        ++pos;
+      if (pos == begin)
+        return std::nullopt;
+      item.key = iconvlite::cp2utf(std::string_view(spec).substr(begin, pos - begin));
+      ++result.arguments;
+    }
+    item.offset = result.cells;
+    result.cells += item.length;
+    result.fields.push_back(std::move(item));
+  }
+  return result;
+}
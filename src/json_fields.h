@@ -0,0 +1,72 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "common.h"
+
+/**
+ * Parsed field specification, e.g. "i:money s[24]:name f:health".
+ * Each token is <type>[<length>]:<key>, where type is one of:
+ *   i (or d) - integer, f - float, b - boolean, s[length] - string,
+ *   j - JsonNode, x[length] - padding (no key, no argument)
+ * Offsets are counted in cells from the start of the record, so a spec
+ * also describes the memory layout of an enum-indexed Pawn array.
+ */
+class json_fields {
+public:
+  enum class field_type : uint8_t {
+    integer,
+    floating,
+    boolean,
+    string,
+    node,
+    padding
+  };
+
+  struct field {
+    field_type type;
+    std::string key; // UTF-8
+    size_t offset;   // in cells
+    size_t length;   // in cells
+  };
+
+  std::vector<field> fields;
+  size_t cells{0};
+  size_t arguments{0};
+
+  /**
+   * @brief Returns type of field which receives index-th argument (padding takes no argument)
+   * @param index Index of argument
+   * @return Field type or padding if there is no such argument
+   */
+  field_type argument_type(size_t index) const;
+
+  /**
+   * @brief Returns parsed spec, parsing it only on first use
+   * @param spec Field specification
+   * @return Parsed fields or nullptr on syntax error
+   */
+  static const json_fields *get(const std::string &spec);
+private:
+  static std::optional<json_fields> parse(const std::string &spec);
+};
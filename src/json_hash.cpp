@@ -0,0 +1,120 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "json_hash.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+// distinct seeds keep e.g. "1", 1 and [1] apart
+constexpr uint64_t kNullSeed = 0x6a09e667f3bcc908ull;
+constexpr uint64_t kBoolSeed = 0xbb67ae8584caa73bull;
+constexpr uint64_t kNumberSeed = 0x3c6ef372fe94f82bull;
+constexpr uint64_t kStringSeed = 0xa54ff53a5f1d36f1ull;
+constexpr uint64_t kArraySeed = 0x510e527fade682d1ull;
+constexpr uint64_t kObjectSeed = 0x9b05688c2b3e6c1full;
+constexpr uint64_t kKeySeed = 0x1f83d9abfb41bd6bull;
+constexpr int64_t kExactInteger = int64_t{1} << 53; // integers beyond it compare with floats through a rounded double
+}
+
+// splitmix64 finalizer
+uint64_t json_hash::mix(uint64_t value) {
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9ull;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111ebull;
+  value ^= value >> 31;
+  return value;
+}
+
+uint64_t json_hash::bytes(std::string_view text, uint64_t seed) {
+  auto hash = mix(seed ^ text.size());
+  size_t offset = 0;
+  for (; offset + sizeof(uint64_t) <= text.size(); offset += sizeof(uint64_t)) {
+    uint64_t chunk;
+    std::memcpy(&chunk, text.data() + offset, sizeof(chunk));
+    hash = mix(hash ^ chunk);
+  }
+  if (offset < text.size()) {
+    uint64_t chunk = 0;
+    std::memcpy(&chunk, text.data() + offset, text.size() - offset);
+    hash = mix(hash ^ chunk);
+  }
+  return hash;
+}
+
+uint64_t json_hash::number(double value) {
+  // integral floats hash like the integers they compare equal to, -0.0 like 0
+  if (std::trunc(value) == value && value >= -9223372036854775808.0 && value < 9223372036854775808.0)
+    return mix(kNumberSeed ^ static_cast<uint64_t>(static_cast<int64_t>(value)));
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return mix(kNumberSeed ^ mix(bits));
+}
+
+uint64_t json_hash::compute(const nlohmann::ordered_json &value) {
+  bool comparable = true;
+  return compute(value, comparable);
+}
+
+uint64_t json_hash::compute(const nlohmann::ordered_json &value, bool &comparable) {
+  using value_t = nlohmann::detail::value_t;
+  switch (value.type()) {
+  case value_t::null:
+  case value_t::discarded:return mix(kNullSeed);
+  case value_t::boolean:return mix(kBoolSeed ^ static_cast<uint64_t>(value.get<bool>()));
+  case value_t::number_integer: {
+    // integer equals a float when its double does, so large ones are hashed by their double;
+    // integers equal to each other still round to the same double
+    auto integer = value.get<int64_t>();
+    if (integer >= -kExactInteger && integer <= kExactInteger)
+      return mix(kNumberSeed ^ static_cast<uint64_t>(integer));
+    return number(static_cast<double>(integer));
+  }
+  case value_t::number_unsigned: {
+    auto integer = value.get<uint64_t>();
+    if (integer <= static_cast<uint64_t>(kExactInteger))
+      return mix(kNumberSeed ^ integer);
+    if (integer > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))
+      comparable = false;
+    return number(static_cast<double>(integer));
+  }
+  case value_t::number_float:return number(value.get<double>());
+  case value_t::string:return bytes(value.get_ref<const std::string &>(), kStringSeed);
+  case value_t::binary:return bytes({reinterpret_cast<const char *>(value.get_binary().data()), value.get_binary().size()}, kStringSeed);
+  case value_t::array: {
+    auto hash = mix(kArraySeed ^ value.size());
+    for (const auto &item : value)
+      hash = mix(hash ^ compute(item, comparable)) + 0x9e3779b97f4a7c15ull;
+    return hash;
+  }
+  case value_t::object: {
+    // sum of member hashes does not depend on member order
+    uint64_t sum = 0;
+    for (auto item = value.cbegin(); item != value.cend(); ++item)
+      sum += mix(bytes(item.key(), kKeySeed) ^ (compute(item.value(), comparable) * 0x9e3779b97f4a7c15ull));
+    return mix(kObjectSeed ^ value.size()) ^ mix(sum);
+  }
+  }
+  return 0;
+}
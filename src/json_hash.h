@@ -0,0 +1,47 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "common.h"
+
+/**
+ * Canonical 64-bit structural hash. Values which compare equal hash equally: numbers are
+ * hashed by value, so 1 and 1.0 match like they do for operator==, and object members are
+ * combined independently of their order, so reordered documents also hash equally.
+ * Different hashes prove values differ; equal hashes still need a deep comparison.
+ * The one exception is an unsigned number above INT64_MAX, which operator== finds equal both
+ * to a float and to a negative integer (it compares integers as int64_t); no single hash
+ * agrees with both, so such values are reported as not comparable by hash.
+ */
+class json_hash {
+  static uint64_t mix(uint64_t value);
+  static uint64_t bytes(std::string_view text, uint64_t seed);
+  static uint64_t number(double value);
+public:
+  static uint64_t compute(const nlohmann::ordered_json &value);
+  /**
+   * @brief Computes hash and whether it may be compared to prove values differ
+   * @param comparable Cleared if value contains a number whose hash may differ from an equal value's one
+   */
+  static uint64_t compute(const nlohmann::ordered_json &value, bool &comparable);
+};
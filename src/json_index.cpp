@@ -0,0 +1,120 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "json_index.h"
+#include <cmath>
+
+json_index::json_index(node_ptr_t node, std::string array_key, nlohmann::ordered_json::json_pointer key_pointer)
+    : node(node), array_key(std::move(array_key)), key_pointer(std::move(key_pointer)) {}
+
+nlohmann::ordered_json *json_index::array() const {
+  auto result = node;
+  if (!array_key.empty()) {
+    if (!node->is_object())
+      return nullptr;
+    auto item = node->find(array_key);
+    if (item == node->end())
+      return nullptr;
+    result = &*item;
+  }
+  return result->is_array() ? result : nullptr;
+}
+
+const nlohmann::ordered_json *json_index::key_of(const nlohmann::ordered_json &item) const {
+  if (!item.contains(key_pointer))
+    return nullptr;
+  return &item.at(key_pointer);
+}
+
+// equal numbers of different storage types (e.g. parsed 5u and JSON_Int(5)) must hash equally
+nlohmann::ordered_json json_index::normalized(const nlohmann::ordered_json &value) {
+  if (value.is_number_unsigned() && value.get<uint64_t>() <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))
+    return value.get<int64_t>();
+  if (value.is_number_float()) {
+    auto number = value.get<double>();
+    if (std::trunc(number) == number && std::abs(number) < 9.2e18)
+      return static_cast<int64_t>(number);
+  }
+  return value;
+}
+
+void json_index::rebuild() {
+  positions.clear();
+  has_duplicates = false;
+  dirty = false;
+  auto items = array();
+  if (items == nullptr)
+    return;
+  positions.reserve(items->size());
+  for (size_t i = 0; i < items->size(); ++i) {
+    if (auto key = key_of((*items)[i]))
+      has_duplicates |= !positions.try_emplace(normalized(*key), i).second;
+  }
+}
+
+void json_index::appended() {
+  if (dirty)
+    return;
+  auto items = array();
+  if (items == nullptr || items->empty()) {
+    dirty = true;
+    return;
+  }
+  if (auto key = key_of(items->back()))
+    has_duplicates |= !positions.try_emplace(normalized(*key), items->size() - 1).second;
+}
+
+void json_index::removing(size_t position) {
+  if (dirty)
+    return;
+  if (has_duplicates) {
+    dirty = true;
+    return;
+  }
+  auto items = array();
+  if (items == nullptr || position >= items->size()) {
+    dirty = true;
+    return;
+  }
+  if (auto key = key_of((*items)[position]))
+    positions.erase(normalized(*key));
+  // elements after the removed one shift down by one
+  for (auto &[key, index] : positions) {
+    if (index > position)
+      --index;
+  }
+}
+
+void json_index::cleared() {
+  positions.clear();
+  has_duplicates = false;
+  dirty = false;
+}
+
+std::optional<size_t> json_index::find(const nlohmann::ordered_json &value) {
+  if (dirty)
+    rebuild();
+  auto item = positions.find(normalized(value));
+  if (item == positions.end())
+    return std::nullopt;
+  return item->second;
+}
@@ -0,0 +1,70 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "common.h"
+
+/**
+ * Hash index over an array of objects, mapping value found at key pointer of each
+ * element to its position. The array is either the indexed node itself or its
+ * member by array key. Array natives keep the index up to date incrementally; any
+ * other change of the node marks it dirty, and it is rebuilt on next lookup.
+ */
+class json_index {
+  node_ptr_t node;
+  std::string array_key; // as passed by script, empty if node itself is the array
+  nlohmann::ordered_json::json_pointer key_pointer;
+  std::unordered_map<nlohmann::ordered_json, size_t> positions;
+  bool dirty{true};
+  bool has_duplicates{false}; // removal may expose an element shadowed by the removed one
+
+  const nlohmann::ordered_json *key_of(const nlohmann::ordered_json &item) const;
+  static nlohmann::ordered_json normalized(const nlohmann::ordered_json &value);
+  void rebuild();
+public:
+  json_index(node_ptr_t node, std::string array_key, nlohmann::ordered_json::json_pointer key_pointer);
+
+  node_ptr_t indexed_node() const { return node; }
+  const std::string &indexed_array_key() const { return array_key; }
+
+  /**
+   * @brief Returns indexed array or nullptr if node has no array by array key anymore
+   */
+  nlohmann::ordered_json *array() const;
+
+  void invalidate() { dirty = true; }
+  /**
+   * @brief Indexes element which was appended to the end of array
+   */
+  void appended();
+  /**
+   * @brief Unindexes element which is about to be erased at position
+   */
+  void removing(size_t position);
+  void cleared();
+
+  /**
+   * @brief Looks up position of first element with value at key pointer equal to value
+   */
+  std::optional<size_t> find(const nlohmann::ordered_json &value);
+};
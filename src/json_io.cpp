@@ -0,0 +1,308 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "json_io.h"
+#include <cstring>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static constexpr uint32_t kLz4FrameMagic = 0x184D2204;
+
+static std::FILE *open_file(const std::filesystem::path &filename, bool write) {
+#ifdef _WIN32
+  return _wfopen(filename.c_str(), write ? L"wb" : L"rb");
+#else
+  return std::fopen(filename.c_str(), write ? "wb" : "rb");
+#endif
+}
+
+// makes written data durable, otherwise a power loss after rename may leave an empty file in place of the old one
+static bool sync_file(std::FILE *file) {
+  if (std::fflush(file) != 0)
+    return false;
+#ifdef _WIN32
+  return _commit(_fileno(file)) == 0;
+#else
+  return fsync(fileno(file)) == 0;
+#endif
+}
+
+json_file_writer::json_file_writer(std::FILE *file, size_t buffer_size, JsonCompression compression)
+    : file(file), buffer(buffer_size) {
+  if (compression != JSON_COMPRESSION_LZ4)
+    return;
+  LZ4F_preferences_t preferences{};
+  preferences.compressionLevel = compression_level;
+  preferences.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+  compressed.resize(std::max<size_t>(LZ4F_compressBound(buffer_size, &preferences), LZ4F_HEADER_SIZE_MAX));
+  if (LZ4F_isError(LZ4F_createCompressionContext(&lz4, LZ4F_VERSION))) {
+    lz4 = nullptr;
+    failed = true;
+    return;
+  }
+  auto header = LZ4F_compressBegin(lz4, compressed.data(), compressed.size(), &preferences);
+  if (LZ4F_isError(header) || std::fwrite(compressed.data(), 1, header, file) != header)
+    failed = true;
+}
+
+json_file_writer::~json_file_writer() {
+  if (lz4 != nullptr)
+    LZ4F_freeCompressionContext(lz4);
+}
+
+void json_file_writer::write_out(const char *data, size_t length) {
+  if (failed)
+    return;
+  if (lz4 == nullptr) {
+    if (std::fwrite(data, 1, length, file) != length)
+      failed = true;
+    return;
+  }
+  // compressed buffer is sized for one text buffer, so feed it in such chunks
+  for (size_t offset = 0; offset < length && !failed; offset += buffer.size()) {
+    auto chunk = std::min(buffer.size(), length - offset);
+    auto size = LZ4F_compressUpdate(lz4, compressed.data(), compressed.size(), data + offset, chunk, nullptr);
+    if (LZ4F_isError(size) || std::fwrite(compressed.data(), 1, size, file) != size)
+      failed = true;
+  }
+}
+
+void json_file_writer::flush_buffer() {
+  if (used != 0)
+    write_out(buffer.data(), used);
+  used = 0;
+}
+
+void json_file_writer::write_character(char c) {
+  if (used == buffer.size())
+    flush_buffer();
+  buffer[used++] = c;
+}
+
+void json_file_writer::write_characters(const char *s, std::size_t length) {
+  if (length > buffer.size() - used) {
+    flush_buffer();
+    // long strings go straight out instead of through the buffer
+    if (length >= buffer.size()) {
+      write_out(s, length);
+      return;
+    }
+  }
+  std::memcpy(buffer.data() + used, s, length);
+  used += length;
+}
+
+bool json_file_writer::finish() {
+  flush_buffer();
+  if (lz4 != nullptr && !failed) {
+    auto size = LZ4F_compressEnd(lz4, compressed.data(), compressed.size(), nullptr);
+    if (LZ4F_isError(size) || std::fwrite(compressed.data(), 1, size, file) != size)
+      failed = true;
+  }
+  return !failed;
+}
+
+bool json_file_writer::save(const std::filesystem::path &filename, const nlohmann::ordered_json &node, int indent, JsonCompression compression) {
+  return save(filename, dump_node(node, indent), compression);
+}
+
+bool json_file_writer::save(const std::filesystem::path &filename, const dump_function &dump, JsonCompression compression) {
+  if (compression == JSON_COMPRESSION_AUTO)
+    compression = filename.extension() == ".lz4" ? JSON_COMPRESSION_LZ4 : JSON_COMPRESSION_NONE;
+  // written next to the file and renamed over it, so a crash mid-save never leaves a truncated file;
+  // the counter keeps names unique when several saves run at once
+  static std::atomic<unsigned> temporary_counter{0};
+  auto temporary = filename;
+  temporary += "." + std::to_string(temporary_counter++) + ".tmp";
+  std::error_code error;
+  try {
+    if (!write(temporary, dump, compression)) {
+      std::filesystem::remove(temporary, error);
+      return false;
+    }
+  } catch (...) {
+    std::filesystem::remove(temporary, error);
+    throw;
+  }
+  std::filesystem::rename(temporary, filename, error);
+  if (error) {
+    std::filesystem::remove(temporary, error);
+    return false;
+  }
+  return true;
+}
+
+JsonCallResult json_file_writer::save_file(const std::filesystem::path &filename, const nlohmann::ordered_json &node, int indent, JsonCompression compression) {
+  return save_file(filename, dump_node(node, indent), compression);
+}
+
+JsonCallResult json_file_writer::save_file(const std::filesystem::path &filename, const dump_function &dump, JsonCompression compression) {
+  auto parent_path = filename.parent_path();
+  if (!parent_path.empty()) {
+    if (!exists(parent_path)) {
+      create_directories(parent_path);
+    } else if (!is_directory(parent_path)) {
+      return JSON_CALL_NO_SUCH_DIR_ERR;
+    }
+  }
+  return save(filename, dump, compression) ? JSON_CALL_NO_ERR : JSON_CALL_UNKNOWN_ERR;
+}
+
+void json_file_writer::save_batch(std::vector<batch_item> &items, int indent, JsonCompression compression) {
+  json_parallel_for(items.size(), [&](size_t i) {
+    auto &item = items[i];
+    if (item.result != JSON_CALL_NO_ERR)
+      return;
+    try {
+      item.result = save_file(item.filename, *item.node, indent, compression);
+      if (item.result != JSON_CALL_NO_ERR)
+        item.error = "could not write file";
+    } catch (const std::exception &e) {
+      item.result = JSON_CALL_PARSER_ERR;
+      item.error = e.what();
+    }
+  });
+}
+
+json_file_writer::dump_function json_file_writer::dump_node(const nlohmann::ordered_json &node, int indent) {
+  return [&node, indent](const std::shared_ptr<json_file_writer> &writer) {
+    nlohmann::detail::serializer<nlohmann::ordered_json> serializer(writer, ' ');
+    if (indent >= 0)
+      serializer.dump(node, true, false, static_cast<unsigned int>(indent));
+    else
+      serializer.dump(node, false, false, 0);
+  };
+}
+
+bool json_file_writer::write(const std::filesystem::path &filename, const dump_function &dump, JsonCompression compression) {
+  auto file = open_file(filename, true);
+  if (file == nullptr)
+    return false;
+  // our buffer is the only one, so every flush is a single write to the file descriptor
+  std::setvbuf(file, nullptr, _IONBF, 0);
+  auto writer = std::make_shared<json_file_writer>(file, buffer_size, compression);
+  bool written;
+  try {
+    dump(writer);
+    writer->write_character('\n');
+    written = writer->finish() && (!sync_saves || sync_file(file));
+  } catch (...) {
+    std::fclose(file);
+    throw;
+  }
+  return std::fclose(file) == 0 && written;
+}
+
+json_lz4_streambuf::json_lz4_streambuf(std::FILE *file) : file(file), input(kChunkSize), output(kChunkSize) {
+  if (LZ4F_isError(LZ4F_createDecompressionContext(&lz4, LZ4F_VERSION)))
+    throw std::runtime_error("could not create LZ4 decompression context");
+}
+
+json_lz4_streambuf::~json_lz4_streambuf() {
+  LZ4F_freeDecompressionContext(lz4);
+}
+
+json_lz4_streambuf::int_type json_lz4_streambuf::underflow() {
+  while (!finished) {
+    if (input_position == input_size) {
+      input_size = std::fread(input.data(), 1, input.size(), file);
+      input_position = 0;
+      if (input_size == 0)
+        throw std::runtime_error("unexpected end of LZ4 frame");
+    }
+    auto output_size = output.size();
+    auto consumed = input_size - input_position;
+    auto hint = LZ4F_decompress(lz4, output.data(), &output_size, input.data() + input_position, &consumed, nullptr);
+    if (LZ4F_isError(hint))
+      throw std::runtime_error(std::string("LZ4 error: ") + LZ4F_getErrorName(hint));
+    input_position += consumed;
+    // decoder returns 0 once the frame is complete; data after it is ignored
+    finished = hint == 0;
+    if (output_size != 0) {
+      setg(output.data(), output.data(), output.data() + output_size);
+      return traits_type::to_int_type(output[0]);
+    }
+  }
+  return traits_type::eof();
+}
+
+bool json_file_reader::starts_with_lz4_frame(std::FILE *file) {
+  unsigned char magic[4]{};
+  auto read = std::fread(magic, 1, sizeof(magic), file);
+  auto value = static_cast<uint32_t>(magic[0]) | static_cast<uint32_t>(magic[1]) << 8
+      | static_cast<uint32_t>(magic[2]) << 16 | static_cast<uint32_t>(magic[3]) << 24;
+  std::rewind(file);
+  return read == sizeof(magic) && value == kLz4FrameMagic;
+}
+
+nlohmann::ordered_json json_file_reader::parse(const std::filesystem::path &filename) {
+  auto file = open_file(filename, false);
+  if (file == nullptr)
+    throw std::runtime_error("could not open file");
+  std::unique_ptr<std::FILE, decltype(&std::fclose)> guard(file, &std::fclose);
+  if (starts_with_lz4_frame(file)) {
+    json_lz4_streambuf buffer(file);
+    std::istream stream(&buffer);
+    return nlohmann::ordered_json::parse(stream);
+  }
+  return nlohmann::ordered_json::parse(file);
+}
+
+std::string json_file_reader::read(const std::filesystem::path &filename) {
+  auto file = open_file(filename, false);
+  if (file == nullptr)
+    throw std::runtime_error("could not open file");
+  std::unique_ptr<std::FILE, decltype(&std::fclose)> guard(file, &std::fclose);
+  std::string text;
+  if (starts_with_lz4_frame(file)) {
+    json_lz4_streambuf buffer(file);
+    text.assign(std::istreambuf_iterator<char>(&buffer), std::istreambuf_iterator<char>());
+    return text;
+  }
+  char chunk[64 * 1024];
+  size_t read;
+  while ((read = std::fread(chunk, 1, sizeof(chunk), file)) != 0)
+    text.append(chunk, read);
+  if (std::ferror(file))
+    throw std::runtime_error("could not read file");
+  return text;
+}
+
+void json_file_reader::parse_batch(std::vector<batch_item> &items) {
+  json_parallel_for(items.size(), [&](size_t i) {
+    auto &item = items[i];
+    try {
+      if (!exists(item.filename) || !is_regular_file(item.filename)) {
+        item.result = JSON_CALL_NO_SUCH_FILE_ERR;
+        item.error = "file not exists";
+        return;
+      }
+      item.value = parse(item.filename);
+    } catch (const std::exception &e) {
+      item.result = JSON_CALL_PARSER_ERR;
+      item.error = e.what();
+    }
+  });
+}
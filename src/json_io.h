@@ -0,0 +1,174 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "common.h"
+#include <cstdio>
+#include <streambuf>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <system_error>
+#include "lz4/lib/lz4frame.h"
+#include "lz4/lib/lz4hc.h"
+
+/**
+ * Runs body(i) for every i below count on a pool of worker threads, one per core at most.
+ * Calling thread is one of the workers; returns once every body has finished.
+ */
+template <typename F>
+void json_parallel_for(size_t count, F body) {
+  std::atomic<size_t> next{0};
+  auto worker = [&]() {
+    for (auto i = next++; i < count; i = next++)
+      body(i);
+  };
+  auto threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), count);
+  std::vector<std::thread> pool;
+  pool.reserve(threads);
+  try {
+    for (size_t i = 1; i < threads; ++i)
+      pool.emplace_back(worker);
+  } catch (const std::system_error &) {
+    // out of threads; workers started so far (at least the calling one) still process every item
+  }
+  worker();
+  for (auto &thread : pool)
+    thread.join();
+}
+
+/**
+ * Serializer output adapter which streams text to a file through a fixed-size
+ * buffer, so saving a document never holds its whole text in memory. With LZ4
+ * enabled, each flushed buffer is compressed into an LZ4 frame on the way out.
+ */
+class json_file_writer : public nlohmann::detail::output_adapter_protocol<char> {
+  std::FILE *file;
+  std::vector<char> buffer;
+  size_t used{0};
+  bool failed{false};
+  LZ4F_cctx *lz4{nullptr};
+  std::vector<char> compressed;
+
+  void flush_buffer();
+  void write_out(const char *data, size_t length);
+public:
+  static constexpr size_t kMinBufferSize = 512;
+  static constexpr size_t kMaxBufferSize = 16 * 1024 * 1024;
+  static inline size_t buffer_size = 64 * 1024; // JSON_OPTION_SAVE_BUFFER_SIZE
+  static inline int compression_level = 0;      // JSON_OPTION_COMPRESSION_LEVEL
+  static inline bool sync_saves = false;        // JSON_OPTION_SAVE_SYNC
+
+  json_file_writer(std::FILE *file, size_t buffer_size, JsonCompression compression);
+  ~json_file_writer() override;
+
+  void write_character(char c) override;
+  void write_characters(const char *s, std::size_t length) override;
+
+  /**
+   * @brief Writes out buffered text and ends compressed frame
+   * @return Whether every write succeeded
+   */
+  bool finish();
+
+  // writes text of document into writer, without trailing newline
+  using dump_function = std::function<void(const std::shared_ptr<json_file_writer> &writer)>;
+
+  struct batch_item {
+    const nlohmann::ordered_json *node;
+    std::filesystem::path filename;
+    JsonCallResult result{JSON_CALL_NO_ERR}; // items which already have an error are skipped
+    std::string error;
+  };
+
+  /**
+   * @brief Serializes node to file followed by a newline, like node->dump(indent)
+   * @param compression Compression, JSON_COMPRESSION_AUTO picks LZ4 for ".lz4" files
+   * @return Whether file was written completely. File is replaced atomically, it is left intact on failure
+   */
+  static bool save(const std::filesystem::path &filename, const nlohmann::ordered_json &node, int indent, JsonCompression compression);
+  static bool save(const std::filesystem::path &filename, const dump_function &dump, JsonCompression compression);
+  /**
+   * @brief Creates missing directories of file and saves node to it
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NO_SUCH_DIR_ERR if parent path is not a directory
+   *            JSON_CALL_UNKNOWN_ERR if file could not be written
+   */
+  static JsonCallResult save_file(const std::filesystem::path &filename, const nlohmann::ordered_json &node, int indent, JsonCompression compression);
+  static JsonCallResult save_file(const std::filesystem::path &filename, const dump_function &dump, JsonCompression compression);
+  /**
+   * @brief Saves nodes of items in parallel, see json_parallel_for
+   * @note Nodes must not change until it returns. Errors are stored into items
+   */
+  static void save_batch(std::vector<batch_item> &items, int indent, JsonCompression compression);
+private:
+  static dump_function dump_node(const nlohmann::ordered_json &node, int indent);
+  static bool write(const std::filesystem::path &filename, const dump_function &dump, JsonCompression compression);
+};
+
+/**
+ * Stream buffer which decompresses LZ4 frame from file chunk by chunk,
+ * so compressed documents are parsed without inflating them in memory first.
+ */
+class json_lz4_streambuf : public std::streambuf {
+  static constexpr size_t kChunkSize = 64 * 1024;
+
+  std::FILE *file;
+  LZ4F_dctx *lz4{nullptr};
+  std::vector<char> input;
+  size_t input_position{0};
+  size_t input_size{0};
+  std::vector<char> output;
+  bool finished{false};
+
+protected:
+  int_type underflow() override;
+public:
+  explicit json_lz4_streambuf(std::FILE *file);
+  ~json_lz4_streambuf() override;
+};
+
+class json_file_reader {
+  static bool starts_with_lz4_frame(std::FILE *file);
+public:
+  struct batch_item {
+    std::filesystem::path filename;
+    nlohmann::ordered_json value;
+    JsonCallResult result{JSON_CALL_NO_ERR};
+    std::string error;
+  };
+
+  /**
+   * @brief Parses file, decompressing it if it starts with LZ4 frame magic
+   */
+  static nlohmann::ordered_json parse(const std::filesystem::path &filename);
+  /**
+   * @brief Reads whole text of file, decompressing it like parse() does
+   */
+  static std::string read(const std::filesystem::path &filename);
+  /**
+   * @brief Parses files of items on a pool of worker threads, one per core at most
+   * @note Errors are stored into items instead of being thrown or logged, since workers must not touch the server
+   */
+  static void parse_batch(std::vector<batch_item> &items);
+};
@@ -0,0 +1,125 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "json_lazy.h"
+#include <cstring>
+
+// Text is validated before it is scanned, so scanning only has to find where values end
+
+size_t json_lazy::skip_whitespace(size_t position) const {
+  while (position < text.size() && (text[position] == ' ' || text[position] == '\t' || text[position] == '\n' || text[position] == '\r'))
+    ++position;
+  return position;
+}
+
+size_t json_lazy::skip_string(size_t position) const {
+  for (++position;; position += 2) {
+    position = text.find_first_of("\"\\", position);
+    if (text[position] == '"')
+      return position + 1;
+  }
+}
+
+size_t json_lazy::skip_value(size_t position) const {
+  auto c = text[position];
+  if (c == '"')
+    return skip_string(position);
+  if (c != '{' && c != '[') {
+    // number or literal
+    while (position < text.size() && std::string_view(",}] \t\n\r").find(text[position]) == std::string_view::npos)
+      ++position;
+    return position;
+  }
+  size_t depth = 0;
+  do {
+    c = text[position];
+    if (c == '"') {
+      position = skip_string(position);
+      continue;
+    }
+    if (c == '{' || c == '[')
+      ++depth;
+    else if (c == '}' || c == ']')
+      --depth;
+    ++position;
+  } while (depth != 0);
+  return position;
+}
+
+std::unique_ptr<json_lazy> json_lazy::parse(std::string text, nlohmann::ordered_json &root) {
+  if (!nlohmann::ordered_json::accept(text)) {
+    // throws with the position of the error
+    root = nlohmann::ordered_json::parse(text);
+  }
+  auto lazy = std::make_unique<json_lazy>(std::move(text));
+  auto &source = lazy->text;
+  size_t position = source.compare(0, 3, "\xEF\xBB\xBF") == 0 ? 3 : 0;
+  position = lazy->skip_whitespace(position);
+  if (source[position] != '{') {
+    root = nlohmann::ordered_json::parse(source);
+    return nullptr;
+  }
+  root = nlohmann::ordered_json::object();
+  auto &members = root.get_ref<nlohmann::ordered_json::object_t &>();
+  position = lazy->skip_whitespace(position + 1);
+  while (source[position] != '}') {
+    auto key_begin = position;
+    position = lazy->skip_string(position);
+    std::string key;
+    // only escaped keys need decoding; the scan must stay within the key or lazy parsing becomes quadratic
+    if (std::memchr(source.data() + key_begin, '\\', position - key_begin) != nullptr)
+      key = nlohmann::ordered_json::parse(source.data() + key_begin, source.data() + position).get<std::string>();
+    else
+      key = source.substr(key_begin + 1, position - key_begin - 2);
+    position = lazy->skip_whitespace(lazy->skip_whitespace(position) + 1); // ':'
+    auto value_begin = position;
+    position = lazy->skip_value(position);
+    // later duplicate replaces earlier one in place, like a full parse does; pending already tells
+    // duplicates apart, so new keys are appended without the linear search of ordered_map
+    if (lazy->pending.insert_or_assign(key, std::make_pair(value_begin, position)).second)
+      members.emplace_back(std::move(key), nullptr);
+    position = lazy->skip_whitespace(position);
+    if (source[position] == ',')
+      position = lazy->skip_whitespace(position + 1);
+  }
+  return lazy;
+}
+
+void json_lazy::materialize(nlohmann::ordered_json &root, const std::string &key) {
+  auto range = pending.find(key);
+  if (range == pending.end())
+    return;
+  auto item = root.find(key);
+  if (item != root.end())
+    *item = nlohmann::ordered_json::parse(text.data() + range->second.first, text.data() + range->second.second);
+  pending.erase(range);
+}
+
+void json_lazy::materialize(nlohmann::ordered_json &root) {
+  for (auto &[key, range] : pending) {
+    auto item = root.find(key);
+    if (item != root.end())
+      *item = nlohmann::ordered_json::parse(text.data() + range.first, text.data() + range.second);
+  }
+  pending.clear();
+}
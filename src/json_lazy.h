@@ -0,0 +1,67 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include "common.h"
+
+/**
+ * Lazily parsed object. Text is validated once, then only the byte ranges of
+ * top-level members are indexed; each member is parsed when it is first accessed.
+ * The object node itself holds null placeholders, so its keys, their order and
+ * its size are available without parsing any member.
+ */
+class json_lazy {
+  std::string text;
+  std::unordered_map<std::string, std::pair<size_t, size_t>> pending; // key -> range of raw value in text
+
+  size_t skip_whitespace(size_t position) const;
+  size_t skip_string(size_t position) const;
+  size_t skip_value(size_t position) const;
+public:
+  explicit json_lazy(std::string text) : text(std::move(text)) {}
+
+  /**
+   * @brief Validates text and indexes members if it is an object
+   * @param root Set to object with placeholders, or to fully parsed value if text is not an object
+   * @return Lazy object, nullptr if text is not an object
+   * @throws nlohmann::ordered_json::parse_error if text is not valid JSON
+   */
+  static std::unique_ptr<json_lazy> parse(std::string text, nlohmann::ordered_json &root);
+
+  /**
+   * @brief Parses member into root unless it was parsed or forgotten already
+   */
+  void materialize(nlohmann::ordered_json &root, const std::string &key);
+  /**
+   * @brief Parses every pending member into root
+   */
+  void materialize(nlohmann::ordered_json &root);
+  /**
+   * @brief Drops member which is about to be overwritten or removed
+   */
+  void forget(const std::string &key) { pending.erase(key); }
+
+  bool done() const { return pending.empty(); }
+  size_t text_size() const { return text.capacity(); }
+};
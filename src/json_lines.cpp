@@ -0,0 +1,88 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "json_lines.h"
+
+json_lines::json_lines(std::FILE *file) : file(file) {}
+
+json_lines::~json_lines() {
+  std::fclose(file);
+}
+
+std::unique_ptr<json_lines> json_lines::open(const std::filesystem::path &filename) {
+#ifdef _WIN32
+  auto file = _wfopen(filename.c_str(), L"rb");
+#else
+  auto file = std::fopen(filename.c_str(), "rb");
+#endif
+  if (file == nullptr)
+    return nullptr;
+  return std::make_unique<json_lines>(file);
+}
+
+bool json_lines::fill() {
+  if (eof)
+    return false;
+  // drop consumed records so the buffer only grows for lines longer than a chunk
+  buffer.erase(0, position);
+  position = 0;
+  auto size = buffer.size();
+  buffer.resize(size + kChunkSize);
+  auto read = std::fread(buffer.data() + size, 1, kChunkSize, file);
+  buffer.resize(size + read);
+  if (read < kChunkSize)
+    eof = true;
+  return read != 0;
+}
+
+std::optional<std::string_view> json_lines::next() {
+  while (true) {
+    size_t end;
+    size_t search_from = position;
+    while ((end = buffer.find('\n', search_from)) == std::string::npos) {
+      auto scanned = buffer.size() - position;
+      if (!fill())
+        break;
+      search_from = position + scanned;
+    }
+
+    std::string_view record;
+    if (end == std::string::npos) {
+      if (position == buffer.size())
+        return std::nullopt;
+      // last line without terminator
+      record = std::string_view(buffer).substr(position);
+      position = buffer.size();
+    } else {
+      record = std::string_view(buffer).substr(position, end - position);
+      position = end + 1;
+    }
+    ++line;
+
+    if (line == 1 && record.substr(0, 3) == "\xEF\xBB\xBF")
+      record.remove_prefix(3);
+    while (!record.empty() && (record.back() == '\r' || record.back() == ' ' || record.back() == '\t'))
+      record.remove_suffix(1);
+    if (record.find_first_not_of(" \t") != std::string_view::npos)
+      return record;
+  }
+}
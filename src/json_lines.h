@@ -0,0 +1,62 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "common.h"
+#include <cstdio>
+#include <string_view>
+
+/**
+ * Sequential reader of JSON Lines files. The file is read in large chunks and split
+ * into records in place, so a line is never copied before it is handed to the parser.
+ */
+class json_lines {
+  static constexpr size_t kChunkSize = 1024 * 1024;
+
+  std::FILE *file;
+  std::string buffer;
+  size_t position{0}; // start of the first unconsumed byte in buffer
+  bool eof{false};
+  uint64_t line{0};
+
+  bool fill();
+public:
+  explicit json_lines(std::FILE *file);
+  ~json_lines();
+
+  /**
+   * @brief Opens file for reading
+   * @return Reader or nullptr if file could not be opened
+   */
+  static std::unique_ptr<json_lines> open(const std::filesystem::path &filename);
+
+  /**
+   * @brief Returns next non-blank record without line terminator. The view stays valid until next call
+   */
+  std::optional<std::string_view> next();
+
+  /**
+   * @brief Line number of the last record returned by next()
+   */
+  uint64_t line_number() const { return line; }
+};
@@ -0,0 +1,131 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "json_log.h"
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+json_log::json_log(std::FILE *file, std::chrono::milliseconds flush_interval, JsonLogSync sync)
+    : file(file), flush_interval(flush_interval), sync(sync), writer(&json_log::run, this) {}
+
+json_log::~json_log() {
+  {
+    std::lock_guard lock(mutex);
+    stopping = true;
+  }
+  wake.notify_one();
+  writer.join();
+  if (sync != JSON_LOG_SYNC_NONE)
+    sync_file();
+  std::fclose(file);
+}
+
+std::unique_ptr<json_log> json_log::open(const std::filesystem::path &filename, std::chrono::milliseconds flush_interval, JsonLogSync sync) {
+  auto parent_path = filename.parent_path();
+  if (!parent_path.empty() && !exists(parent_path))
+    create_directories(parent_path);
+#ifdef _WIN32
+  auto file = _wfopen(filename.c_str(), L"ab");
+#else
+  auto file = std::fopen(filename.c_str(), "ab");
+#endif
+  if (file == nullptr)
+    return nullptr;
+  return std::make_unique<json_log>(file, flush_interval, sync);
+}
+
+bool json_log::append(const nlohmann::ordered_json &node) {
+  if (failed)
+    return false;
+  bool wake_writer;
+  {
+    std::lock_guard lock(mutex);
+    auto size = pending.size();
+    try {
+      nlohmann::detail::serializer<nlohmann::ordered_json> serializer(nlohmann::detail::output_adapter<char>(pending), ' ');
+      serializer.dump(node, false, false, 0);
+    } catch (...) {
+      pending.resize(size);
+      throw;
+    }
+    pending.push_back('\n');
+    ++appended;
+    wake_writer = pending.size() >= kWakeThreshold;
+  }
+  if (wake_writer)
+    wake.notify_one();
+  return true;
+}
+
+bool json_log::flush() {
+  std::unique_lock lock(mutex);
+  auto target = appended;
+  flush_requested = true;
+  wake.notify_one();
+  flushed.wait(lock, [&] { return (sync == JSON_LOG_SYNC_NONE ? written : synced) >= target || failed; });
+  return !failed;
+}
+
+void json_log::run() {
+  std::string batch;
+  std::unique_lock lock(mutex);
+  while (true) {
+    wake.wait_for(lock, flush_interval, [&] {
+      return stopping || flush_requested || pending.size() >= kWakeThreshold;
+    });
+    auto sync_requested = flush_requested && sync == JSON_LOG_SYNC_FLUSH;
+    flush_requested = false;
+    if (!pending.empty()) {
+      batch.swap(pending);
+      auto batch_records = appended;
+      lock.unlock();
+      if (std::fwrite(batch.data(), 1, batch.size(), file) != batch.size() || std::fflush(file) != 0)
+        failed = true;
+      batch.clear();
+      lock.lock();
+      written = batch_records;
+    }
+    // records written by earlier interval batches are synced too, not only the batch written just now
+    if (!failed && synced < written && (sync_requested || sync == JSON_LOG_SYNC_ALWAYS)) {
+      auto sync_records = written;
+      lock.unlock();
+      if (!sync_file())
+        failed = true;
+      lock.lock();
+      synced = sync_records;
+    }
+    flushed.notify_all();
+    if (stopping && pending.empty())
+      break;
+  }
+}
+
+bool json_log::sync_file() {
+#ifdef _WIN32
+  return _commit(_fileno(file)) == 0;
+#else
+  return fsync(fileno(file)) == 0;
+#endif
+}
@@ -0,0 +1,70 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "common.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdio>
+
+/**
+ * Append-only JSON Lines file. Nodes are serialized on the caller's thread into
+ * a shared buffer; a background writer swaps the buffer out and writes the whole
+ * batch with one call every flush interval (group commit).
+ */
+class json_log {
+  static constexpr size_t kWakeThreshold = 1024 * 1024; // wake writer early once this much is pending
+
+  std::FILE *file;
+  std::chrono::milliseconds flush_interval;
+  JsonLogSync sync;
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable flushed;
+  std::string pending;
+  uint64_t appended{0}; // count of appended records
+  uint64_t written{0};  // count of records handed to the OS
+  uint64_t synced{0};   // count of records known to be on disk, tracked unless sync is JSON_LOG_SYNC_NONE
+  bool flush_requested{false};
+  bool stopping{false};
+  std::atomic_bool failed{false};
+  std::thread writer;
+
+  void run();
+  bool sync_file();
+public:
+  json_log(std::FILE *file, std::chrono::milliseconds flush_interval, JsonLogSync sync);
+  ~json_log();
+
+  /**
+   * @brief Opens log file for appending, creating missing directories
+   * @return Log or nullptr if file could not be opened
+   */
+  static std::unique_ptr<json_log> open(const std::filesystem::path &filename, std::chrono::milliseconds flush_interval, JsonLogSync sync);
+
+  bool append(const nlohmann::ordered_json &node);
+  bool flush();
+};
@@ -0,0 +1,122 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "json_memory.h"
+
+size_t json_memory_stats::string_heap_size(const std::string &str) {
+  static const auto small_capacity = std::string().capacity();
+  return str.capacity() > small_capacity ? str.capacity() + 1 : 0;
+}
+
+// keys are const members of object's buffer, so growing the buffer copies them with capacity
+// trimmed to length; counting length keeps their size independent of reallocations
+size_t json_memory_stats::key_heap_size(const std::string &key) {
+  static const auto small_capacity = std::string().capacity();
+  return key.size() > small_capacity ? key.size() + 1 : 0;
+}
+
+void json_memory_stats::add(const nlohmann::ordered_json &root) {
+  bytes += sizeof(nlohmann::ordered_json);
+  add_value(root);
+}
+
+void json_memory_stats::add_value(const nlohmann::ordered_json &value) {
+  using json = nlohmann::ordered_json;
+  ++values;
+  switch (value.type()) {
+    case json::value_t::object: {
+      auto &object = value.get_ref<const json::object_t &>();
+      ++objects;
+      members += object.size();
+      bytes += container_size(value);
+      for (auto &[key, item] : object) {
+        auto heap_size = key_heap_size(key);
+        bytes += heap_size;
+        key_bytes += heap_size;
+        if (track_keys && ++keys[key] > 1)
+          duplicate_key_bytes += heap_size;
+        add_value(item);
+      }
+      break;
+    }
+    case json::value_t::array: {
+      auto &array = value.get_ref<const json::array_t &>();
+      ++arrays;
+      bytes += container_size(value);
+      for (auto &item : array)
+        add_value(item);
+      break;
+    }
+    case json::value_t::string:
+      ++strings;
+      bytes += sizeof(json::string_t) + string_heap_size(value.get_ref<const json::string_t &>());
+      break;
+    case json::value_t::binary: {
+      auto &binary = value.get_ref<const json::binary_t &>();
+      bytes += sizeof(json::binary_t) + binary.capacity();
+      break;
+    }
+    default:
+      // stored inline
+      break;
+  }
+}
+
+size_t json_memory_stats::estimate(const nlohmann::ordered_json &root) {
+  json_memory_stats stats;
+  stats.track_keys = false;
+  stats.add(root);
+  return stats.bytes;
+}
+
+size_t json_memory_stats::heap_size(const nlohmann::ordered_json &value) {
+  return estimate(value) - sizeof(nlohmann::ordered_json);
+}
+
+size_t json_memory_stats::container_size(const nlohmann::ordered_json &value) {
+  using json = nlohmann::ordered_json;
+  if (value.is_object())
+    return sizeof(json::object_t) + value.get_ref<const json::object_t &>().capacity() * sizeof(json::object_t::value_type);
+  if (value.is_array())
+    return sizeof(json::array_t) + value.get_ref<const json::array_t &>().capacity() * sizeof(json);
+  return 0;
+}
+
+size_t json_memory_stats::member_size(const nlohmann::ordered_json &object, const std::string &key) {
+  if (!object.is_object())
+    return 0;
+  auto item = object.find(key);
+  return item != object.end() ? key_heap_size(item.key()) + heap_size(*item) : 0;
+}
+
+size_t json_memory_stats::insert_growth(const nlohmann::ordered_json &container, size_t count) {
+  using json = nlohmann::ordered_json;
+  // null becomes an object when a member is set
+  size_t slot = container.is_array() ? sizeof(json) : sizeof(json::object_t::value_type);
+  size_t size = container.is_structured() ? container.size() : 0;
+  size_t capacity = container.is_structured() ? (container_size(container) - (container.is_array() ? sizeof(json::array_t) : sizeof(json::object_t))) / slot : 0;
+  if (size + count <= capacity)
+    return 0;
+  // vector grows at least twice
+  return (std::max(capacity * 2, size + count) - capacity) * slot + (container.is_structured() ? 0 : sizeof(json::object_t));
+}
@@ -0,0 +1,84 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include "common.h"
+
+/**
+ * Estimates memory held by JSON trees and collects statistics over their object keys.
+ * Sizes are estimates of what the standard containers allocate: inline value sizes plus
+ * heap buffers of strings, arrays and objects. Short strings fitting into the small
+ * string buffer are counted as not allocating.
+ */
+class json_memory_stats {
+  // key text -> count of occurrences; views point into added trees, which must outlive stats
+  std::unordered_map<std::string_view, size_t> keys;
+  bool track_keys{true};
+
+  void add_value(const nlohmann::ordered_json &value);
+public:
+  size_t values{0};
+  size_t objects{0};
+  size_t arrays{0};
+  size_t strings{0};
+  size_t members{0};
+  size_t bytes{0};               // estimated total, including root values
+  size_t key_bytes{0};           // heap bytes held by object keys
+  size_t duplicate_key_bytes{0}; // heap bytes held by keys repeating an earlier one
+
+  /**
+   * @brief Adds tree to statistics
+   */
+  void add(const nlohmann::ordered_json &root);
+  size_t distinct_keys() const { return keys.size(); }
+
+  /**
+   * @brief Returns heap bytes allocated by string, 0 if it fits into small string buffer
+   */
+  static size_t string_heap_size(const std::string &str);
+  /**
+   * @brief Returns heap bytes allocated by object key, 0 if it fits into small string buffer
+   */
+  static size_t key_heap_size(const std::string &key);
+  /**
+   * @brief Returns estimated deep size of tree in bytes
+   */
+  static size_t estimate(const nlohmann::ordered_json &root);
+  /**
+   * @brief Returns estimated deep size of value held inside a container, whose slot is counted with the container
+   */
+  static size_t heap_size(const nlohmann::ordered_json &value);
+  /**
+   * @brief Returns size of buffer of object or array itself, without its items. 0 for other types
+   */
+  static size_t container_size(const nlohmann::ordered_json &value);
+  /**
+   * @brief Returns size of object member (key and value) held outside of object's buffer, 0 if there is no such member
+   */
+  static size_t member_size(const nlohmann::ordered_json &object, const std::string &key);
+  /**
+   * @brief Returns upper bound of growth of container's buffer when count items are inserted
+   */
+  static size_t insert_growth(const nlohmann::ordered_json &container, size_t count = 1);
+};
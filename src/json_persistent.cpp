@@ -0,0 +1,286 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "json_persistent.h"
+
+json_persistent::node_ptr json_persistent::make(nlohmann::ordered_json value) {
+  auto result = std::make_shared<node>();
+  if (value.is_object()) {
+    auto &members = value.get_ref<nlohmann::ordered_json::object_t &>();
+    result->scalar = nlohmann::ordered_json::object();
+    result->members.reserve(members.size());
+    for (auto &[key, item] : members)
+      result->members.emplace_back(key, make(std::move(item)));
+  } else if (value.is_array()) {
+    auto &items = value.get_ref<nlohmann::ordered_json::array_t &>();
+    result->scalar = nlohmann::ordered_json::array();
+    result->items.reserve(items.size());
+    for (auto &item : items)
+      result->items.push_back(make(std::move(item)));
+  } else {
+    result->scalar = std::move(value);
+  }
+  return result;
+}
+
+void json_persistent::materialize(const node &item, nlohmann::ordered_json &out) {
+  out = item.scalar;
+  if (item.scalar.is_object()) {
+    for (auto &[key, member] : item.members)
+      materialize(*member, out[key]);
+  } else if (item.scalar.is_array()) {
+    auto &items = out.get_ref<nlohmann::ordered_json::array_t &>();
+    items.resize(item.items.size());
+    for (size_t i = 0; i < items.size(); ++i)
+      materialize(*item.items[i], items[i]);
+  }
+}
+
+// array positions must be plain decimal numbers, like in JSON pointers
+static std::optional<size_t> to_position(const std::string &key) {
+  if (key.empty() || key.size() > 9 || key.find_first_not_of("0123456789") != std::string::npos)
+    return std::nullopt;
+  return static_cast<size_t>(std::stoul(key));
+}
+
+json_persistent::node_ptr json_persistent::find_child(const node &parent, const std::string &key) {
+  if (parent.scalar.is_object()) {
+    for (auto &[member_key, member] : parent.members) {
+      if (member_key == key)
+        return member;
+    }
+  } else if (parent.scalar.is_array()) {
+    auto position = to_position(key);
+    if (position && *position < parent.items.size())
+      return parent.items[*position];
+  }
+  return nullptr;
+}
+
+std::optional<nlohmann::ordered_json> json_persistent::get(const std::vector<std::string> &keys) const {
+  auto current = root;
+  for (const auto &key : keys) {
+    current = find_child(*current, key);
+    if (current == nullptr)
+      return std::nullopt;
+  }
+  nlohmann::ordered_json result;
+  materialize(*current, result);
+  return result;
+}
+
+bool json_persistent::settable(const std::vector<std::string> &keys) const {
+  auto current = root;
+  for (const auto &key : keys) {
+    if (!current->scalar.is_object() && !current->scalar.is_array())
+      return false;
+    auto child = find_child(*current, key);
+    if (child == nullptr)
+      return current->scalar.is_object(); // rest of the path is created
+    current = child;
+  }
+  return true;
+}
+
+// returns copy of current with value at keys[depth..] replaced (or removed if value is null),
+// current itself is never changed since older versions may share it
+json_persistent::node_ptr json_persistent::replace(const node_ptr &current, const std::vector<std::string> &keys, size_t depth, const node_ptr &value, bool &replaced) {
+  if (depth == keys.size()) {
+    replaced = true;
+    return value;
+  }
+  const auto &key = keys[depth];
+  auto last = depth + 1 == keys.size();
+  if (current->scalar.is_object()) {
+    auto copy = std::make_shared<node>(*current);
+    auto member = std::find_if(copy->members.begin(), copy->members.end(), [&](const auto &item) { return item.first == key; });
+    if (member == copy->members.end()) {
+      if (value == nullptr)
+        return current;
+      // like operator[] of a regular node, missing members on the path become objects
+      auto child = last ? value : replace(make(nlohmann::ordered_json::object()), keys, depth + 1, value, replaced);
+      if (!replaced && !last)
+        return current;
+      copy->members.emplace_back(key, child);
+      replaced = true;
+      return copy;
+    }
+    if (last && value == nullptr) {
+      copy->members.erase(member);
+      replaced = true;
+      return copy;
+    }
+    member->second = replace(member->second, keys, depth + 1, value, replaced);
+    return replaced ? copy : current;
+  }
+  if (current->scalar.is_array()) {
+    auto position = to_position(key);
+    if (!position || *position >= current->items.size())
+      return current;
+    auto copy = std::make_shared<node>(*current);
+    if (last && value == nullptr) {
+      copy->items.erase(copy->items.begin() + *position);
+      replaced = true;
+      return copy;
+    }
+    copy->items[*position] = replace(copy->items[*position], keys, depth + 1, value, replaced);
+    return replaced ? copy : current;
+  }
+  return current;
+}
+
+bool json_persistent::set(const std::vector<std::string> &keys, nlohmann::ordered_json value) {
+  bool replaced = false;
+  auto result = replace(root, keys, 0, make(std::move(value)), replaced);
+  if (replaced)
+    root = std::move(result);
+  return replaced;
+}
+
+bool json_persistent::remove(const std::vector<std::string> &keys) {
+  if (keys.empty())
+    return false;
+  bool replaced = false;
+  auto result = replace(root, keys, 0, nullptr, replaced);
+  if (replaced)
+    root = std::move(result);
+  return replaced;
+}
+
+void json_persistent::dump(nlohmann::detail::serializer<nlohmann::ordered_json> &serializer, nlohmann::detail::output_adapter_protocol<char> &out, const node &item, int indent, unsigned int current_indent) {
+  auto pretty = indent >= 0;
+  auto is_object = item.scalar.is_object();
+  if (!is_object && !item.scalar.is_array()) {
+    serializer.dump(item.scalar, pretty, false, pretty ? static_cast<unsigned int>(indent) : 0, current_indent);
+    return;
+  }
+  auto count = is_object ? item.members.size() : item.items.size();
+  if (count == 0) {
+    out.write_characters(is_object ? "{}" : "[]", 2);
+    return;
+  }
+  // same layout as nlohmann serializer produces
+  auto inner_indent = pretty ? current_indent + static_cast<unsigned int>(indent) : 0;
+  std::string padding(inner_indent, ' ');
+  out.write_character(is_object ? '{' : '[');
+  for (size_t i = 0; i < count; ++i) {
+    if (i != 0)
+      out.write_character(',');
+    if (pretty) {
+      out.write_character('\n');
+      out.write_characters(padding.data(), padding.size());
+    }
+    if (is_object) {
+      serializer.dump(nlohmann::ordered_json(item.members[i].first), false, false, 0);
+      out.write_characters(pretty ? ": " : ":", pretty ? 2 : 1);
+    }
+    dump(serializer, out, is_object ? *item.members[i].second : *item.items[i], indent, inner_indent);
+  }
+  if (pretty) {
+    out.write_character('\n');
+    out.write_characters(padding.data(), current_indent);
+  }
+  out.write_character(is_object ? '}' : ']');
+}
+
+void json_persistent::dump(const nlohmann::detail::output_adapter_t<char> &out, int indent) const {
+  nlohmann::detail::serializer<nlohmann::ordered_json> serializer(out, ' ');
+  dump(serializer, *out, *root, indent, 0);
+}
+
+// escapes key into JSON pointer token, like JSON patch paths need
+static std::string pointer_token(const std::string &key) {
+  std::string token;
+  token.reserve(key.size() + 1);
+  token.push_back('/');
+  for (char ch : key) {
+    if (ch == '~')
+      token += "~0";
+    else if (ch == '/')
+      token += "~1";
+    else
+      token.push_back(ch);
+  }
+  return token;
+}
+
+// appends same operations as nlohmann::ordered_json::diff does, except that shared subtrees are not visited
+void json_persistent::diff(const node_ptr &source, const node_ptr &target, const std::string &path, nlohmann::ordered_json &patch) {
+  if (source == target)
+    return;
+  auto is_container = [](const node &item) { return item.scalar.is_object() || item.scalar.is_array(); };
+  // numbers of different types may still be equal
+  if (!is_container(*source) && !is_container(*target) && source->scalar == target->scalar)
+    return;
+  if (source->scalar.type() != target->scalar.type()) {
+    nlohmann::ordered_json value;
+    materialize(*target, value);
+    patch.push_back({{"op", "replace"}, {"path", path}, {"value", std::move(value)}});
+    return;
+  }
+  if (source->scalar.is_array()) {
+    size_t i = 0;
+    for (; i < source->items.size() && i < target->items.size(); ++i)
+      diff(source->items[i], target->items[i], path + "/" + std::to_string(i), patch);
+    // removed from the end, so that positions of elements not yet removed stay valid
+    for (auto j = source->items.size(); j > i; --j)
+      patch.push_back({{"op", "remove"}, {"path", path + "/" + std::to_string(j - 1)}});
+    for (; i < target->items.size(); ++i) {
+      nlohmann::ordered_json value;
+      materialize(*target->items[i], value);
+      patch.push_back({{"op", "add"}, {"path", path + "/-"}, {"value", std::move(value)}});
+    }
+  } else if (source->scalar.is_object()) {
+    std::unordered_map<std::string_view, const node_ptr *> target_members;
+    target_members.reserve(target->members.size());
+    for (auto &[key, member] : target->members)
+      target_members.emplace(key, &member);
+    std::unordered_set<std::string_view> source_keys;
+    source_keys.reserve(source->members.size());
+    for (auto &[key, member] : source->members) {
+      source_keys.insert(key);
+      auto other = target_members.find(key);
+      if (other != target_members.end())
+        diff(member, *other->second, path + pointer_token(key), patch);
+      else
+        patch.push_back({{"op", "remove"}, {"path", path + pointer_token(key)}});
+    }
+    for (auto &[key, member] : target->members) {
+      if (source_keys.find(key) != source_keys.end())
+        continue;
+      nlohmann::ordered_json value;
+      materialize(*member, value);
+      patch.push_back({{"op", "add"}, {"path", path + pointer_token(key)}, {"value", std::move(value)}});
+    }
+  } else {
+    nlohmann::ordered_json value;
+    materialize(*target, value);
+    patch.push_back({{"op", "replace"}, {"path", path}, {"value", std::move(value)}});
+  }
+}
+
+nlohmann::ordered_json json_persistent::diff(const json_persistent &other) const {
+  auto patch = nlohmann::ordered_json::array();
+  diff(root, other.root, "", patch);
+  return patch;
+}
@@ -0,0 +1,84 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include "common.h"
+
+/**
+ * Immutable document whose versions share unchanged subtrees. Copying a document
+ * copies a single pointer; an edit copies only the containers on the path to the
+ * edited value and shares everything else with the previous version, which stays
+ * valid for every other document referring to it. Building the first version from a
+ * regular value is O(n), with one allocation per value.
+ */
+class json_persistent {
+  struct node;
+  using node_ptr = std::shared_ptr<const node>;
+  struct node {
+    nlohmann::ordered_json scalar; // value of non-container node, otherwise empty object or array
+    std::vector<std::pair<std::string, node_ptr>> members;
+    std::vector<node_ptr> items;
+  };
+
+  node_ptr root;
+
+  static node_ptr make(nlohmann::ordered_json value);
+  static void materialize(const node &item, nlohmann::ordered_json &out);
+  static node_ptr find_child(const node &parent, const std::string &key);
+  static node_ptr replace(const node_ptr &current, const std::vector<std::string> &keys, size_t depth, const node_ptr &value, bool &replaced);
+  static void dump(nlohmann::detail::serializer<nlohmann::ordered_json> &serializer, nlohmann::detail::output_adapter_protocol<char> &out, const node &item, int indent, unsigned int current_indent);
+  static void diff(const node_ptr &source, const node_ptr &target, const std::string &path, nlohmann::ordered_json &patch);
+public:
+  explicit json_persistent(nlohmann::ordered_json value) : root(make(std::move(value))) {}
+  json_persistent(const json_persistent &other) = default;
+
+  /**
+   * @brief Builds value at key path, nullopt if there is no such value
+   * @param keys Object keys or array positions, empty for the whole document
+   */
+  std::optional<nlohmann::ordered_json> get(const std::vector<std::string> &keys) const;
+  /**
+   * @brief Checks whether set() would succeed for key path
+   */
+  bool settable(const std::vector<std::string> &keys) const;
+  /**
+   * @brief Sets value at key path; missing object members on the path are created as objects
+   * @return Whether key path leads through objects and existing array positions only
+   */
+  bool set(const std::vector<std::string> &keys, nlohmann::ordered_json value);
+  /**
+   * @brief Removes value at key path
+   * @return Whether value existed
+   */
+  bool remove(const std::vector<std::string> &keys);
+  /**
+   * @brief Serializes document like nlohmann::ordered_json::dump(indent) without building it first
+   */
+  void dump(const nlohmann::detail::output_adapter_t<char> &out, int indent) const;
+  /**
+   * @brief Builds JSON patch turning this document into other, like nlohmann::ordered_json::diff.
+   * Subtrees shared by both documents are skipped without being compared
+   */
+  nlohmann::ordered_json diff(const json_persistent &other) const;
+};
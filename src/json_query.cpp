@@ -0,0 +1,479 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "json_query.h"
+
+using json = nlohmann::ordered_json;
+
+static std::unordered_map<std::string, std::unique_ptr<json_query>> compiled_queries;
+
+static const json null_value;
+static const json true_value = true;
+static const json false_value = false;
+
+class json_query::parser {
+  const std::string &text;
+  size_t pos{0};
+  size_t depth{0};
+
+  [[noreturn]] void fail(const std::string &what) const {
+    throw std::invalid_argument(what + " at " + std::to_string(pos));
+  }
+
+  void skip_spaces() {
+    while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos])))
+      ++pos;
+  }
+
+  bool accept(std::string_view token) {
+    skip_spaces();
+    if (text.compare(pos, token.size(), token) != 0)
+      return false;
+    pos += token.size();
+    return true;
+  }
+
+  void expect(std::string_view token) {
+    if (!accept(token))
+      fail("expected '" + std::string(token) + "'");
+  }
+
+  char peek() {
+    skip_spaces();
+    return pos < text.size() ? text[pos] : '\0';
+  }
+
+  static bool is_identifier_start(char c) {
+    return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+  }
+
+  static std::unique_ptr<node> make(node_kind kind, std::unique_ptr<node> left = nullptr, std::unique_ptr<node> right = nullptr) {
+    auto result = std::make_unique<node>(kind);
+    result->left = std::move(left);
+    result->right = std::move(right);
+    return result;
+  }
+
+  // binary operators nest to the left, so every one of them counts towards kMaxDepth like a nested chain
+  void nest() {
+    if (++depth > kMaxDepth)
+      fail("expression is nested too deep");
+  }
+
+  std::unique_ptr<node> parse_pipe() {
+    auto outer_depth = depth;
+    auto left = parse_or();
+    while (accept("|")) {
+      nest();
+      left = make(node_kind::pipe, std::move(left), parse_or());
+    }
+    depth = outer_depth;
+    return left;
+  }
+
+  std::unique_ptr<node> parse_or() {
+    auto outer_depth = depth;
+    auto left = parse_and();
+    while (accept("||")) {
+      nest();
+      left = make(node_kind::or_expression, std::move(left), parse_and());
+    }
+    depth = outer_depth;
+    return left;
+  }
+
+  std::unique_ptr<node> parse_and() {
+    auto outer_depth = depth;
+    auto left = parse_not();
+    while (accept("&&")) {
+      nest();
+      left = make(node_kind::and_expression, std::move(left), parse_not());
+    }
+    depth = outer_depth;
+    return left;
+  }
+
+  std::unique_ptr<node> parse_not() {
+    skip_spaces();
+    if (pos < text.size() && text[pos] == '!' && text.compare(pos, 2, "!=") != 0) {
+      ++pos;
+      // each '!' nests once more, like a parenthesized chain does
+      if (++depth > kMaxDepth)
+        fail("expression is nested too deep");
+      auto result = make(node_kind::not_expression, parse_not());
+      --depth;
+      return result;
+    }
+    return parse_comparison();
+  }
+
+  std::unique_ptr<node> parse_comparison() {
+    auto left = parse_chain();
+    static constexpr std::pair<std::string_view, compare_op> operators[] = {
+        {"==", compare_op::eq}, {"!=", compare_op::ne}, {"<=", compare_op::le},
+        {">=", compare_op::ge}, {"<", compare_op::lt}, {">", compare_op::gt}};
+    for (const auto &[token, op] : operators) {
+      if (accept(token)) {
+        auto result = make(node_kind::comparison, std::move(left), parse_chain());
+        result->op = op;
+        return result;
+      }
+    }
+    return left;
+  }
+
+  std::unique_ptr<node> parse_chain() {
+    if (++depth > kMaxDepth)
+      fail("expression is nested too deep");
+    std::unique_ptr<node> left;
+    auto c = peek();
+    if (c == '[') {
+      left = make(node_kind::current);
+    } else if (c == '*') {
+      ++pos;
+      left = make(node_kind::value_projection, make(node_kind::current), parse_postfix(make(node_kind::current)));
+      --depth;
+      return left;
+    } else {
+      left = parse_primary();
+    }
+    left = parse_postfix(std::move(left));
+    --depth;
+    return left;
+  }
+
+  std::unique_ptr<node> parse_primary() {
+    auto c = peek();
+    if (c == '@') {
+      ++pos;
+      return make(node_kind::current);
+    }
+    if (c == '(') {
+      ++pos;
+      auto result = parse_pipe();
+      expect(")");
+      return result;
+    }
+    if (c == '`') {
+      auto end = text.find('`', pos + 1);
+      if (end == std::string::npos)
+        fail("unterminated literal");
+      auto result = make(node_kind::literal);
+      try {
+        result->literal = json::parse(text.begin() + pos + 1, text.begin() + end);
+      } catch (const std::exception &) {
+        fail("invalid literal");
+      }
+      pos = end + 1;
+      return result;
+    }
+    if (c == '\'') {
+      auto result = make(node_kind::literal);
+      std::string value;
+      for (++pos; pos < text.size() && text[pos] != '\''; ++pos) {
+        if (text[pos] == '\\' && pos + 1 < text.size() && text[pos + 1] == '\'')
+          ++pos;
+        value.push_back(text[pos]);
+      }
+      if (pos >= text.size())
+        fail("unterminated string");
+      ++pos;
+      result->literal = std::move(value);
+      return result;
+    }
+    if (c == '-' || std::isdigit(static_cast<unsigned char>(c))) {
+      auto start = pos++;
+      while (pos < text.size() && (std::isdigit(static_cast<unsigned char>(text[pos])) || text[pos] == '.'))
+        ++pos;
+      auto result = make(node_kind::literal);
+      try {
+        result->literal = json::parse(text.begin() + start, text.begin() + pos);
+      } catch (const std::exception &) {
+        fail("invalid number");
+      }
+      return result;
+    }
+    auto result = make(node_kind::field);
+    result->name = parse_identifier();
+    return result;
+  }
+
+  std::string parse_identifier() {
+    auto c = peek();
+    if (c == '"') {
+      auto start = pos++;
+      while (pos < text.size() && text[pos] != '"')
+        pos += text[pos] == '\\' ? 2 : 1;
+      if (pos >= text.size())
+        fail("unterminated identifier");
+      ++pos;
+      try {
+        return json::parse(text.begin() + start, text.begin() + pos).get<std::string>();
+      } catch (const std::exception &) {
+        fail("invalid identifier");
+      }
+    }
+    if (!is_identifier_start(c))
+      fail(c == '\0' ? "unexpected end of query" : std::string("unexpected '") + c + "'");
+    auto start = pos;
+    while (pos < text.size() && (is_identifier_start(text[pos]) || std::isdigit(static_cast<unsigned char>(text[pos]))))
+      ++pos;
+    return text.substr(start, pos - start);
+  }
+
+  std::optional<ptrdiff_t> parse_number() {
+    skip_spaces();
+    auto start = pos;
+    if (pos < text.size() && text[pos] == '-')
+      ++pos;
+    while (pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos])))
+      ++pos;
+    if (pos == start)
+      return std::nullopt;
+    if (pos == start + 1 && text[start] == '-')
+      fail("expected number");
+    return std::stol(text.substr(start, pos - start));
+  }
+
+  // parses a[...], .b and projections following left; a projection takes the rest of the chain.
+  // Every step nests the tree (and evaluation) once more, so each one counts towards kMaxDepth
+  std::unique_ptr<node> parse_postfix(std::unique_ptr<node> left) {
+    auto outer_depth = depth;
+    auto result = parse_steps(std::move(left));
+    depth = outer_depth;
+    return result;
+  }
+
+  std::unique_ptr<node> parse_steps(std::unique_ptr<node> left) {
+    while (true) {
+      auto c = peek();
+      if (c == '.' || c == '[')
+        nest();
+      if (accept(".")) {
+        if (accept("*"))
+          return make(node_kind::value_projection, std::move(left), parse_postfix(make(node_kind::current)));
+        auto field = make(node_kind::field);
+        field->name = parse_identifier();
+        left = make(node_kind::subexpression, std::move(left), std::move(field));
+      } else if (accept("[")) {
+        if (accept("?")) {
+          auto condition = parse_pipe();
+          expect("]");
+          auto result = make(node_kind::filter_projection, std::move(left), parse_postfix(make(node_kind::current)));
+          result->condition = std::move(condition);
+          return result;
+        }
+        if (accept("*")) {
+          expect("]");
+          return make(node_kind::list_projection, std::move(left), parse_postfix(make(node_kind::current)));
+        }
+        if (accept("]"))
+          return make(node_kind::flatten_projection, std::move(left), parse_postfix(make(node_kind::current)));
+        auto first = parse_number();
+        if (first && accept("]")) {
+          auto index = make(node_kind::index);
+          index->index = *first;
+          left = make(node_kind::subexpression, std::move(left), std::move(index));
+          continue;
+        }
+        auto slice = make(node_kind::slice_projection, std::move(left));
+        slice->start = first;
+        expect(":");
+        slice->stop = parse_number();
+        if (accept(":")) {
+          if (auto step = parse_number()) {
+            if (*step == 0)
+              fail("slice step cannot be 0");
+            slice->step = *step;
+          }
+        }
+        expect("]");
+        slice->right = parse_postfix(make(node_kind::current));
+        return slice;
+      } else {
+        return left;
+      }
+    }
+  }
+
+public:
+  explicit parser(const std::string &text) : text(text) {}
+
+  std::unique_ptr<node> parse() {
+    auto result = parse_pipe();
+    skip_spaces();
+    if (pos != text.size())
+      fail(std::string("unexpected '") + text[pos] + "'");
+    return result;
+  }
+};
+
+const json_query *json_query::get(const std::string &expression, std::string &error) {
+  error.clear();
+  if (auto cached = compiled_queries.find(expression); cached != compiled_queries.cend())
+    return cached->second.get();
+  auto query = std::make_unique<json_query>();
+  try {
+    query->root = parser(expression).parse();
+  } catch (const std::exception &e) {
+    error = e.what();
+    return nullptr;
+  }
+  // queries may be built at runtime, so keep the cache bounded
+  if (compiled_queries.size() >= kMaxCached)
+    compiled_queries.clear();
+  return compiled_queries.emplace(expression, std::move(query)).first->second.get();
+}
+
+json json_query::evaluate(const json &root_node) const {
+  storage_t storage;
+  return evaluate(*root, root_node, storage);
+}
+
+bool json_query::is_truthy(const json &value) {
+  switch (value.type()) {
+  case json::value_t::null:return false;
+  case json::value_t::boolean:return value.get<bool>();
+  case json::value_t::string:return !value.get_ref<const json::string_t &>().empty();
+  case json::value_t::array:
+  case json::value_t::object:return !value.empty();
+  default:return true;
+  }
+}
+
+const json &json_query::project(const node &expr, const std::vector<const json *> &items, storage_t &storage) {
+  auto &result = storage.emplace_back(json::array());
+  for (auto item : items) {
+    auto &value = evaluate(*expr.right, *item, storage);
+    if (!value.is_null())
+      result.push_back(value);
+  }
+  return result;
+}
+
+const json &json_query::evaluate(const node &expr, const json &current, storage_t &storage) {
+  switch (expr.kind) {
+  case node_kind::current:return current;
+  case node_kind::literal:return expr.literal;
+  case node_kind::field: {
+    if (!current.is_object())
+      return null_value;
+    auto item = current.find(expr.name);
+    return item != current.end() ? *item : null_value;
+  }
+  case node_kind::index: {
+    if (!current.is_array())
+      return null_value;
+    auto size = static_cast<ptrdiff_t>(current.size());
+    auto index = expr.index < 0 ? size + expr.index : expr.index;
+    return index >= 0 && index < size ? current[index] : null_value;
+  }
+  case node_kind::subexpression: {
+    auto &left = evaluate(*expr.left, current, storage);
+    return left.is_null() ? null_value : evaluate(*expr.right, left, storage);
+  }
+  case node_kind::pipe:return evaluate(*expr.right, evaluate(*expr.left, current, storage), storage);
+  case node_kind::list_projection:
+  case node_kind::filter_projection: {
+    auto &left = evaluate(*expr.left, current, storage);
+    if (!left.is_array())
+      return null_value;
+    std::vector<const json *> items;
+    items.reserve(left.size());
+    for (const auto &item : left) {
+      if (expr.kind == node_kind::filter_projection && !is_truthy(evaluate(*expr.condition, item, storage)))
+        continue;
+      items.push_back(&item);
+    }
+    return project(expr, items, storage);
+  }
+  case node_kind::flatten_projection: {
+    auto &left = evaluate(*expr.left, current, storage);
+    if (!left.is_array())
+      return null_value;
+    std::vector<const json *> items;
+    for (const auto &item : left) {
+      if (item.is_array()) {
+        for (const auto &inner : item)
+          items.push_back(&inner);
+      } else {
+        items.push_back(&item);
+      }
+    }
+    return project(expr, items, storage);
+  }
+  case node_kind::value_projection: {
+    auto &left = evaluate(*expr.left, current, storage);
+    if (!left.is_object())
+      return null_value;
+    std::vector<const json *> items;
+    items.reserve(left.size());
+    for (const auto &item : left)
+      items.push_back(&item);
+    return project(expr, items, storage);
+  }
+  case node_kind::slice_projection: {
+    auto &left = evaluate(*expr.left, current, storage);
+    if (!left.is_array())
+      return null_value;
+    auto size = static_cast<ptrdiff_t>(left.size());
+    auto clamp = [&](std::optional<ptrdiff_t> value, ptrdiff_t fallback) {
+      if (!value)
+        return fallback;
+      auto index = *value < 0 ? *value + size : *value;
+      return expr.step > 0 ? std::clamp<ptrdiff_t>(index, 0, size) : std::clamp<ptrdiff_t>(index, -1, size - 1);
+    };
+    auto start = clamp(expr.start, expr.step > 0 ? 0 : size - 1);
+    auto stop = clamp(expr.stop, expr.step > 0 ? size : -1);
+    std::vector<const json *> items;
+    for (auto i = start; expr.step > 0 ? i < stop : i > stop; i += expr.step)
+      items.push_back(&left[i]);
+    return project(expr, items, storage);
+  }
+  case node_kind::comparison: {
+    auto &left = evaluate(*expr.left, current, storage);
+    auto &right = evaluate(*expr.right, current, storage);
+    if (expr.op == compare_op::eq)
+      return left == right ? true_value : false_value;
+    if (expr.op == compare_op::ne)
+      return left != right ? true_value : false_value;
+    if (!left.is_number() || !right.is_number())
+      return null_value;
+    auto a = left.get<double>(), b = right.get<double>();
+    bool result = expr.op == compare_op::lt ? a < b
+        : expr.op == compare_op::le ? a <= b
+        : expr.op == compare_op::gt ? a > b
+        : a >= b;
+    return result ? true_value : false_value;
+  }
+  case node_kind::and_expression: {
+    auto &left = evaluate(*expr.left, current, storage);
+    return is_truthy(left) ? evaluate(*expr.right, current, storage) : left;
+  }
+  case node_kind::or_expression: {
+    auto &left = evaluate(*expr.left, current, storage);
+    return is_truthy(left) ? left : evaluate(*expr.right, current, storage);
+  }
+  case node_kind::not_expression:return is_truthy(evaluate(*expr.left, current, storage)) ? false_value : true_value;
+  }
+  return null_value;
+}
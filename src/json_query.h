@@ -0,0 +1,98 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "common.h"
+#include <deque>
+
+/**
+ * Compiled query over a node, a subset of JMESPath:
+ *   field, "quoted field", @, a.b, a[0], a[-1], a[1:5:2], a[*], a[], a.*,
+ *   a[?expr], a | b, ==, !=, <, <=, >, >=, &&, ||, !, (expr),
+ *   `json literal`, 'raw string' and bare numbers.
+ * Projections ([*], [], [?], slices and .*) apply the rest of the chain to each
+ * element and drop null results, e.g. vehicles[?owner=='X' && fuel<`10`].id
+ */
+class json_query {
+public:
+  /**
+   * @brief Returns compiled query, compiling it only on first use
+   * @param expression Query text (UTF-8)
+   * @param error Description of syntax error
+   * @return Query or nullptr on syntax error. Pointer is valid until next call
+   */
+  static const json_query *get(const std::string &expression, std::string &error);
+
+  /**
+   * @brief Evaluates query against node
+   * @param root Node to query
+   * @return Result value, null if nothing matched
+   */
+  nlohmann::ordered_json evaluate(const nlohmann::ordered_json &root) const;
+
+private:
+  static constexpr size_t kMaxCached = 1024;
+  static constexpr size_t kMaxDepth = 64;
+
+  enum class node_kind : uint8_t {
+    current,
+    field,
+    index,
+    literal,
+    subexpression,
+    list_projection,
+    filter_projection,
+    slice_projection,
+    flatten_projection,
+    value_projection,
+    comparison,
+    and_expression,
+    or_expression,
+    not_expression,
+    pipe
+  };
+
+  enum class compare_op : uint8_t { eq, ne, lt, le, gt, ge };
+
+  struct node {
+    node_kind kind;
+    std::string name;
+    ptrdiff_t index{0};
+    std::optional<ptrdiff_t> start, stop;
+    ptrdiff_t step{1};
+    compare_op op{compare_op::eq};
+    nlohmann::ordered_json literal;
+    std::unique_ptr<node> left, right, condition;
+
+    explicit node(node_kind kind) : kind(kind) {}
+  };
+
+  class parser;
+  using storage_t = std::deque<nlohmann::ordered_json>;
+
+  std::unique_ptr<node> root;
+
+  static bool is_truthy(const nlohmann::ordered_json &value);
+  static const nlohmann::ordered_json &evaluate(const node &expr, const nlohmann::ordered_json &current, storage_t &storage);
+  static const nlohmann::ordered_json &project(const node &expr, const std::vector<const nlohmann::ordered_json *> &items, storage_t &storage);
+};
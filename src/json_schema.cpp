@@ -0,0 +1,325 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "json_schema.h"
+#include <cmath>
+#include <algorithm>
+
+namespace {
+// keywords which are validated, followed by annotations which never affect validation
+const std::unordered_set<std::string> kKeywords = {
+    "type", "enum", "const", "minimum", "maximum", "exclusiveMinimum", "exclusiveMaximum",
+    "minLength", "maxLength", "pattern", "required", "properties", "additionalProperties",
+    "items", "minItems", "maxItems",
+    "$schema", "$id", "$comment", "title", "description", "default", "examples", "definitions",
+    "$defs", "readOnly", "writeOnly", "format", "contentMediaType", "contentEncoding"
+};
+
+uint8_t type_from_name(const std::string &name) {
+  static const std::unordered_map<std::string, uint8_t> types = {
+      {"null", 1 << 0}, {"boolean", 1 << 1}, {"integer", 1 << 2}, {"number", 1 << 3},
+      {"string", 1 << 4}, {"object", 1 << 5}, {"array", 1 << 6}
+  };
+  auto type = types.find(name);
+  return type != types.cend() ? type->second : 0;
+}
+
+std::optional<double> number_keyword(const nlohmann::ordered_json &schema, const char *keyword, std::string &error) {
+  auto value = schema.find(keyword);
+  if (value == schema.cend())
+    return std::nullopt;
+  if (!value->is_number()) {
+    error = std::string("'") + keyword + "' must be a number";
+    return std::nullopt;
+  }
+  return value->get<double>();
+}
+
+std::optional<size_t> count_keyword(const nlohmann::ordered_json &schema, const char *keyword, std::string &error) {
+  auto value = schema.find(keyword);
+  if (value == schema.cend())
+    return std::nullopt;
+  if (!value->is_number_unsigned() && !(value->is_number_integer() && value->get<int64_t>() >= 0)) {
+    error = std::string("'") + keyword + "' must be a non-negative integer";
+    return std::nullopt;
+  }
+  return value->get<size_t>();
+}
+
+size_t utf8_length(const std::string &str) {
+  size_t length = 0;
+  for (unsigned char ch : str) {
+    if ((ch & 0xC0) != 0x80)
+      ++length;
+  }
+  return length;
+}
+
+std::string pointer_token(const std::string &key) {
+  std::string token;
+  token.reserve(key.size() + 1);
+  token.push_back('/');
+  for (char ch : key) {
+    if (ch == '~')
+      token += "~0";
+    else if (ch == '/')
+      token += "~1";
+    else
+      token.push_back(ch);
+  }
+  return token;
+}
+}
+
+std::unique_ptr<json_schema> json_schema::compile(const nlohmann::ordered_json &schema, std::string &error) {
+  error.clear();
+  auto root = compile_rule(schema, error);
+  if (!root)
+    return nullptr;
+  auto result = std::make_unique<json_schema>();
+  result->root = std::move(root);
+  return result;
+}
+
+bool json_schema::validate(const nlohmann::ordered_json &instance, std::string &error) const {
+  if (validate_rule(*root, instance, error))
+    return true;
+  error.insert(0, "#");
+  return false;
+}
+
+std::unique_ptr<json_schema::rule> json_schema::compile_rule(const nlohmann::ordered_json &schema, std::string &error) {
+  auto result = std::make_unique<rule>();
+  if (schema.is_boolean()) {
+    // true accepts anything, false accepts nothing
+    if (!schema.get<bool>())
+      result->allowed.emplace();
+    return result;
+  }
+  if (!schema.is_object()) {
+    error = "schema must be an object or boolean";
+    return nullptr;
+  }
+  for (const auto &[keyword, value] : schema.items()) {
+    if (kKeywords.find(keyword) == kKeywords.cend()) {
+      error = "unsupported keyword '" + keyword + "'";
+      return nullptr;
+    }
+  }
+
+  if (auto type = schema.find("type"); type != schema.cend()) {
+    auto add_type = [&](const nlohmann::ordered_json &name) {
+      auto mask = name.is_string() ? type_from_name(name.get_ref<const std::string &>()) : 0;
+      if (mask == 0)
+        error = "unknown type " + name.dump();
+      result->types |= mask;
+      return mask != 0;
+    };
+    if (type->is_array()) {
+      for (const auto &name : *type) {
+        if (!add_type(name))
+          return nullptr;
+      }
+    } else if (!add_type(*type)) {
+      return nullptr;
+    }
+  }
+  if (auto values = schema.find("enum"); values != schema.cend()) {
+    if (!values->is_array()) {
+      error = "'enum' must be an array";
+      return nullptr;
+    }
+    result->allowed.emplace(values->cbegin(), values->cend());
+  }
+  if (auto value = schema.find("const"); value != schema.cend()) {
+    // both keywords must hold, so only enum values equal to const are left
+    if (result->allowed) {
+      auto &allowed = *result->allowed;
+      allowed.erase(std::remove_if(allowed.begin(), allowed.end(), [&](const auto &item) { return item != *value; }), allowed.end());
+    } else {
+      result->allowed.emplace(1, *value);
+    }
+  }
+
+  result->minimum = number_keyword(schema, "minimum", error);
+  result->maximum = number_keyword(schema, "maximum", error);
+  result->exclusive_minimum = number_keyword(schema, "exclusiveMinimum", error);
+  result->exclusive_maximum = number_keyword(schema, "exclusiveMaximum", error);
+  result->min_length = count_keyword(schema, "minLength", error);
+  result->max_length = count_keyword(schema, "maxLength", error);
+  result->min_items = count_keyword(schema, "minItems", error);
+  result->max_items = count_keyword(schema, "maxItems", error);
+  if (!error.empty())
+    return nullptr;
+
+  if (auto pattern = schema.find("pattern"); pattern != schema.cend()) {
+    if (!pattern->is_string()) {
+      error = "'pattern' must be a string";
+      return nullptr;
+    }
+    try {
+      result->pattern.emplace(pattern->get_ref<const std::string &>(), std::regex::ECMAScript | std::regex::optimize);
+    } catch (const std::regex_error &e) {
+      error = "invalid 'pattern': " + std::string(e.what());
+      return nullptr;
+    }
+  }
+
+  if (auto required = schema.find("required"); required != schema.cend()) {
+    if (!required->is_array()) {
+      error = "'required' must be an array";
+      return nullptr;
+    }
+    for (const auto &key : *required) {
+      if (!key.is_string()) {
+        error = "'required' must contain only strings";
+        return nullptr;
+      }
+      result->required.push_back(key.get<std::string>());
+    }
+  }
+  if (auto properties = schema.find("properties"); properties != schema.cend()) {
+    if (!properties->is_object()) {
+      error = "'properties' must be an object";
+      return nullptr;
+    }
+    for (const auto &[key, subschema] : properties->items()) {
+      auto property = compile_rule(subschema, error);
+      if (!property) {
+        error = "properties" + pointer_token(key) + ": " + error;
+        return nullptr;
+      }
+      result->properties.emplace_back(key, std::move(property));
+    }
+  }
+  if (auto additional = schema.find("additionalProperties"); additional != schema.cend()) {
+    if (additional->is_boolean()) {
+      result->additional_allowed = additional->get<bool>();
+    } else if (!(result->additional = compile_rule(*additional, error))) {
+      error = "additionalProperties: " + error;
+      return nullptr;
+    }
+  }
+  if (auto items = schema.find("items"); items != schema.cend()) {
+    if (!(result->items = compile_rule(*items, error))) {
+      error = "items: " + error;
+      return nullptr;
+    }
+  }
+  return result;
+}
+
+bool json_schema::validate_rule(const rule &r, const nlohmann::ordered_json &instance, std::string &error) {
+  if (r.types != 0) {
+    uint8_t actual;
+    switch (instance.type()) {
+    case nlohmann::ordered_json::value_t::null:actual = kNull;
+      break;
+    case nlohmann::ordered_json::value_t::boolean:actual = kBoolean;
+      break;
+    case nlohmann::ordered_json::value_t::number_integer:
+    case nlohmann::ordered_json::value_t::number_unsigned:actual = kInteger | kNumber;
+      break;
+    case nlohmann::ordered_json::value_t::number_float: {
+      auto value = instance.get<double>();
+      actual = std::floor(value) == value ? (kInteger | kNumber) : kNumber;
+      break;
+    }
+    case nlohmann::ordered_json::value_t::string:actual = kString;
+      break;
+    case nlohmann::ordered_json::value_t::object:actual = kObject;
+      break;
+    case nlohmann::ordered_json::value_t::array:actual = kArray;
+      break;
+    default:actual = 0;
+      break;
+    }
+    if ((r.types & actual) == 0) {
+      error = std::string(": unexpected type ") + instance.type_name();
+      return false;
+    }
+  }
+  if (r.allowed && std::find(r.allowed->cbegin(), r.allowed->cend(), instance) == r.allowed->cend()) {
+    error = ": value is not allowed";
+    return false;
+  }
+
+  if (instance.is_number()) {
+    auto value = instance.get<double>();
+    if ((r.minimum && value < *r.minimum) || (r.exclusive_minimum && value <= *r.exclusive_minimum)) {
+      error = ": value is too small";
+      return false;
+    }
+    if ((r.maximum && value > *r.maximum) || (r.exclusive_maximum && value >= *r.exclusive_maximum)) {
+      error = ": value is too large";
+      return false;
+    }
+  } else if (instance.is_string()) {
+    const auto &value = instance.get_ref<const std::string &>();
+    if (r.min_length || r.max_length) {
+      auto length = utf8_length(value);
+      if ((r.min_length && length < *r.min_length) || (r.max_length && length > *r.max_length)) {
+        error = ": string length is out of range";
+        return false;
+      }
+    }
+    if (r.pattern && !std::regex_search(value, *r.pattern)) {
+      error = ": string does not match pattern";
+      return false;
+    }
+  } else if (instance.is_array()) {
+    if ((r.min_items && instance.size() < *r.min_items) || (r.max_items && instance.size() > *r.max_items)) {
+      error = ": count of items is out of range";
+      return false;
+    }
+    if (r.items) {
+      for (size_t i = 0; i < instance.size(); ++i) {
+        if (!validate_rule(*r.items, instance[i], error)) {
+          error = "/" + std::to_string(i) + error;
+          return false;
+        }
+      }
+    }
+  } else if (instance.is_object()) {
+    for (const auto &key : r.required) {
+      if (!instance.contains(key)) {
+        error = pointer_token(key) + ": required property is missing";
+        return false;
+      }
+    }
+    for (const auto &[key, value] : instance.items()) {
+      auto property = std::find_if(r.properties.cbegin(), r.properties.cend(), [&key = key](const auto &item) {
+        return item.first == key;
+      });
+      const rule *subrule = property != r.properties.cend() ? property->second.get() : r.additional.get();
+      if (property == r.properties.cend() && !r.additional_allowed) {
+        error = pointer_token(key) + ": additional property is not allowed";
+        return false;
+      }
+      if (subrule != nullptr && !validate_rule(*subrule, value, error)) {
+        error = pointer_token(key) + error;
+        return false;
+      }
+    }
+  }
+  return true;
+}
@@ -0,0 +1,81 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "common.h"
+#include <regex>
+
+/**
+ * Compiled JSON Schema validator (draft-07 subset):
+ * type, enum, const, minimum, maximum, exclusiveMinimum, exclusiveMaximum,
+ * minLength, maxLength, pattern, required, properties, additionalProperties,
+ * items, minItems, maxItems.
+ * Annotations ($schema, $id, $comment, title, description, default, examples, definitions,
+ * $defs, readOnly, writeOnly, format, contentMediaType, contentEncoding) are accepted and ignored;
+ * any other keyword fails compilation, so a schema never validates less than it says.
+ * Schema is interpreted once during compilation, validation only walks the instance.
+ */
+class json_schema {
+  enum type_mask : uint8_t {
+    kNull = 1 << 0,
+    kBoolean = 1 << 1,
+    kInteger = 1 << 2,
+    kNumber = 1 << 3,
+    kString = 1 << 4,
+    kObject = 1 << 5,
+    kArray = 1 << 6
+  };
+
+  struct rule {
+    uint8_t types{0}; // 0 = any type
+    std::optional<std::vector<nlohmann::ordered_json>> allowed;
+    std::optional<double> minimum, maximum, exclusive_minimum, exclusive_maximum;
+    std::optional<size_t> min_length, max_length, min_items, max_items;
+    std::optional<std::regex> pattern;
+    std::vector<std::string> required;
+    std::vector<std::pair<std::string, std::unique_ptr<rule>>> properties;
+    bool additional_allowed{true};
+    std::unique_ptr<rule> additional;
+    std::unique_ptr<rule> items;
+  };
+
+  std::unique_ptr<rule> root;
+
+  static std::unique_ptr<rule> compile_rule(const nlohmann::ordered_json &schema, std::string &error);
+  static bool validate_rule(const rule &r, const nlohmann::ordered_json &instance, std::string &error);
+public:
+  /**
+   * @brief Compiles schema into validator
+   * @param schema Schema document
+   * @param error Description of the first unsupported or malformed keyword
+   * @return Validator or nullptr on error
+   */
+  static std::unique_ptr<json_schema> compile(const nlohmann::ordered_json &schema, std::string &error);
+  /**
+   * @brief Validates instance against compiled schema
+   * @param instance Document to validate
+   * @param error JSON pointer and reason of the first violation
+   * @return Whether instance is valid
+   */
+  bool validate(const nlohmann::ordered_json &instance, std::string &error) const;
+};
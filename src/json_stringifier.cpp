@@ -0,0 +1,96 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "json_stringifier.h"
+#include "json_template.h"
+#include "iconvlite.hpp"
+
+json_stringifier::json_stringifier(const nlohmann::ordered_json &root, int indent) : indent(indent) {
+  write_value(root);
+}
+
+void json_stringifier::write_newline(size_t level) {
+  if (indent < 0)
+    return;
+  pending.push_back('\n');
+  pending.append(level * static_cast<size_t>(indent), ' ');
+}
+
+// scalars are written whole, containers are opened and pushed to be continued by step()
+void json_stringifier::write_value(const nlohmann::ordered_json &value) {
+  if (value.is_string()) {
+    pending.push_back('"');
+    json_template::append_escaped(pending, iconvlite::utf2cp(value.get_ref<const std::string &>()));
+    pending.push_back('"');
+  } else if (value.is_object() || value.is_array()) {
+    auto brackets = value.is_object() ? "{}" : "[]";
+    if (value.empty()) {
+      pending += brackets;
+      return;
+    }
+    pending.push_back(brackets[0]);
+    stack.push_back({&value, value.cbegin()});
+  } else {
+    pending += value.dump();
+  }
+}
+
+void json_stringifier::step() {
+  auto &top = stack.back();
+  auto level = stack.size();
+  if (top.item == top.value->cend()) {
+    write_newline(level - 1);
+    pending.push_back(top.value->is_object() ? '}' : ']');
+    stack.pop_back();
+    return;
+  }
+  if (top.item != top.value->cbegin())
+    pending.push_back(',');
+  write_newline(level);
+  auto item = top.item++;
+  if (top.value->is_object()) {
+    pending.push_back('"');
+    json_template::append_escaped(pending, iconvlite::utf2cp(item.key()));
+    pending += indent < 0 ? "\":" : "\": ";
+  }
+  // may push a frame, which invalidates top
+  write_value(*item);
+}
+
+size_t json_stringifier::next(std::string &out, size_t max_size) {
+  size_t written = 0;
+  while (written < max_size) {
+    if (pending_offset == pending.size()) {
+      if (stack.empty())
+        break;
+      pending.clear();
+      pending_offset = 0;
+      step();
+      continue;
+    }
+    auto count = std::min(max_size - written, pending.size() - pending_offset);
+    out.append(pending, pending_offset, count);
+    pending_offset += count;
+    written += count;
+  }
+  return written;
+}
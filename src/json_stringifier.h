@@ -0,0 +1,58 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "common.h"
+
+/**
+ * Resumable serializer. Produces the same text as ordered_json::dump(indent), converted to
+ * the script's codepage, a piece at a time: only the path from the root to the value being
+ * written is kept, so output of any size can be drained through a fixed-size buffer.
+ * The tree must not be modified while the stringifier is in use.
+ */
+class json_stringifier {
+  struct frame {
+    const nlohmann::ordered_json *value;
+    nlohmann::ordered_json::const_iterator item;
+  };
+
+  std::vector<frame> stack;
+  std::string pending; // text produced but not yet returned
+  size_t pending_offset{0};
+  int indent;
+
+  void write_newline(size_t level);
+  void write_value(const nlohmann::ordered_json &value);
+  void step();
+public:
+  json_stringifier(const nlohmann::ordered_json &root, int indent);
+
+  /**
+   * @brief Appends next part of output
+   * @param out Output
+   * @param max_size Maximal count of bytes appended
+   * @return Count of appended bytes, 0 once whole output has been returned
+   */
+  size_t next(std::string &out, size_t max_size);
+  bool done() const { return stack.empty() && pending_offset == pending.size(); }
+};
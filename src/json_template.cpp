@@ -0,0 +1,138 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "json_template.h"
+#include <cmath>
+
+std::optional<json_template> json_template::compile(const std::string &text, std::string &error) {
+  json_template result;
+  std::string literal;
+  bool in_string = false;
+  for (size_t i = 0; i < text.size(); ++i) {
+    auto c = text[i];
+    if (c != '%') {
+      literal.push_back(c);
+      if (in_string && c == '\\' && i + 1 < text.size()) {
+        literal.push_back(text[++i]);
+      } else if (c == '"') {
+        in_string = !in_string;
+      }
+      continue;
+    }
+    if (i + 1 == text.size()) {
+      error = "unterminated placeholder at the end";
+      return std::nullopt;
+    }
+    argument_type type;
+    switch (text[++i]) {
+    case '%':literal.push_back('%');
+      continue;
+    case 's':type = argument_type::string;
+      break;
+    case 'd':
+    case 'i':type = argument_type::integer;
+      break;
+    case 'f':type = argument_type::floating;
+      break;
+    case 'b':type = argument_type::boolean;
+      break;
+    case 'j':type = argument_type::node;
+      break;
+    default:error = std::string("unknown placeholder %") + text[i] + " at " + std::to_string(i - 1);
+      return std::nullopt;
+    }
+    if (in_string && type == argument_type::node) {
+      error = "%j inside string at " + std::to_string(i - 1);
+      return std::nullopt;
+    }
+    result.placeholders.push_back({std::move(literal), type, in_string});
+    literal.clear();
+  }
+  result.tail = std::move(literal);
+
+  // every placeholder renders a valid value, so a sample rendering validates the template
+  std::string sample;
+  for (const auto &item : result.placeholders) {
+    sample += item.literal;
+    if (item.type == argument_type::string)
+      sample += item.in_string ? "" : "\"\"";
+    else if (item.type == argument_type::node)
+      sample += "null";
+    else
+      sample += "0";
+  }
+  sample += result.tail;
+  if (!nlohmann::ordered_json::accept(sample)) {
+    error = "template does not render valid JSON";
+    return std::nullopt;
+  }
+  return result;
+}
+
+void json_template::append_escaped(std::string &out, std::string_view text) {
+  static constexpr char hex[] = "0123456789abcdef";
+  for (auto c : text) {
+    auto byte = static_cast<unsigned char>(c);
+    switch (c) {
+    case '"':out += "\\\"";
+      break;
+    case '\\':out += "\\\\";
+      break;
+    case '\b':out += "\\b";
+      break;
+    case '\f':out += "\\f";
+      break;
+    case '\n':out += "\\n";
+      break;
+    case '\r':out += "\\r";
+      break;
+    case '\t':out += "\\t";
+      break;
+    default:
+      if (byte < 0x20) {
+        out += "\\u00";
+        out.push_back(hex[byte >> 4]);
+        out.push_back(hex[byte & 0xF]);
+      } else {
+        out.push_back(c);
+      }
+    }
+  }
+}
+
+void json_template::append_integer(std::string &out, cell value) {
+  char buffer[16];
+  auto length = std::snprintf(buffer, sizeof(buffer), "%d", static_cast<int>(value));
+  out.append(buffer, length);
+}
+
+void json_template::append_float(std::string &out, float value) {
+  // like dump(), non-finite numbers have no JSON representation
+  if (!std::isfinite(value)) {
+    out += "null";
+    return;
+  }
+  char buffer[64];
+  auto end = nlohmann::detail::to_chars(buffer, buffer + sizeof(buffer), value);
+  out.append(buffer, end);
+}
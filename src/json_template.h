@@ -0,0 +1,66 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include "common.h"
+
+/**
+ * Precompiled output template, e.g. {"user":%s,"id":%d}. Placeholders are
+ *   %s - string, %d (or %i) - integer, %f - float, %b - boolean,
+ *   %j - JsonNode, %% - percent sign.
+ * Inside a JSON string %s inserts escaped text without quotes, %d, %f and %b insert
+ * their text and %j is not allowed. Rendering appends literal parts and formatted
+ * arguments to a buffer, so no tree is built for the output.
+ */
+class json_template {
+public:
+  enum class argument_type : uint8_t {
+    string,
+    integer,
+    floating,
+    boolean,
+    node
+  };
+
+  struct placeholder {
+    std::string literal; // text preceding the placeholder
+    argument_type type;
+    bool in_string;
+  };
+
+  std::vector<placeholder> placeholders;
+  std::string tail; // text following the last placeholder
+
+  /**
+   * @brief Parses template and checks that it renders valid JSON
+   * @param text Template
+   * @param error Set to description of error on failure
+   * @return Template or nullopt on error
+   */
+  static std::optional<json_template> compile(const std::string &text, std::string &error);
+
+  static void append_escaped(std::string &out, std::string_view text);
+  static void append_integer(std::string &out, cell value);
+  static void append_float(std::string &out, float value);
+};
@@ -0,0 +1,139 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "json_trace.h"
+
+json_trace::call::call(uint16_t native_id, uint16_t amx_id) : native_id(native_id), amx_id(amx_id) {}
+
+void json_trace::call::value(const cell value) {
+  put(arg_kind::value);
+  put(value);
+  ++argc;
+}
+
+void json_trace::call::handle(const cell value) {
+  put(arg_kind::handle);
+  put(value);
+  ++argc;
+}
+
+void json_trace::call::string(const std::string &value) {
+  put(arg_kind::string);
+  put(static_cast<uint32_t>(value.size()));
+  args.insert(args.end(), value.cbegin(), value.cend());
+  ++argc;
+}
+
+void json_trace::call::ref(const cell *value, bool is_handle) {
+  put(arg_kind::ref);
+  put(static_cast<uint8_t>(is_handle ? kRefInHandle : 0));
+  put(*value);
+  refs.push_back({args.size(), value});
+  put(*value);
+  ++argc;
+}
+
+void json_trace::call::null_ref() {
+  put(arg_kind::ref);
+  put(static_cast<uint8_t>(kRefNull));
+  put(static_cast<cell>(0));
+  put(static_cast<cell>(0));
+  ++argc;
+}
+
+void json_trace::call::begin() {
+  started = std::chrono::steady_clock::now();
+}
+
+uint16_t json_trace::declare(const char *name, variadic_layout layout) {
+  natives.push_back({name, layout});
+  return static_cast<uint16_t>(natives.size() - 1);
+}
+
+uint16_t json_trace::amx_id(AMX *amx) {
+  return amx_ids.try_emplace(amx, static_cast<uint16_t>(amx_ids.size())).first->second;
+}
+
+call_result_t json_trace::start(const std::filesystem::path &filename) {
+  if (is_active())
+    return JSON_CALL_TRACE_EXISTS_ERR;
+  auto parent_path = filename.parent_path();
+  if (!parent_path.empty() && !is_directory(parent_path))
+    return JSON_CALL_NO_SUCH_DIR_ERR;
+  stream.open(filename, std::ofstream::binary | std::ofstream::trunc);
+  if (!stream.is_open())
+    return JSON_CALL_UNKNOWN_ERR;
+  amx_ids.clear();
+  buffer.clear();
+  buffer.insert(buffer.end(), std::begin(kMagic), std::end(kMagic));
+  auto put = [this](auto value) {
+    auto bytes = reinterpret_cast<const char *>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+  };
+  put(kFormatVersion);
+  put(static_cast<uint32_t>(natives.size()));
+  for (const auto &native : natives) {
+    put(static_cast<uint16_t>(native.name.size()));
+    buffer.insert(buffer.end(), native.name.cbegin(), native.name.cend());
+    put(native.layout);
+  }
+  started = std::chrono::steady_clock::now();
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t json_trace::stop() {
+  if (!is_active())
+    return JSON_CALL_NO_SUCH_TRACE_ERR;
+  flush();
+  stream.close();
+  return JSON_CALL_NO_ERR;
+}
+
+void json_trace::write(call &record, const cell result, bool (*is_handle)(const cell)) {
+  auto finished = std::chrono::steady_clock::now();
+  for (const auto &ref : record.refs) {
+    auto value = *ref.value;
+    std::memcpy(record.args.data() + ref.offset, &value, sizeof(value));
+    if (is_handle(value))
+      record.args[ref.offset - sizeof(cell) - 1] |= kRefOutHandle;
+  }
+  auto put = [this](auto value) {
+    auto bytes = reinterpret_cast<const char *>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+  };
+  put(record.native_id);
+  put(record.amx_id);
+  put(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(record.started - started).count()));
+  put(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(finished - record.started).count()));
+  put(result);
+  put(static_cast<uint8_t>(is_handle(result)));
+  put(record.argc);
+  buffer.insert(buffer.end(), record.args.cbegin(), record.args.cend());
+  if (buffer.size() >= kFlushThreshold)
+    flush();
+}
+
+void json_trace::flush() {
+  stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+  stream.flush();
+  buffer.clear();
+}
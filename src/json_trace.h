@@ -0,0 +1,121 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "common.h"
+
+/**
+ * Binary recorder of native calls.
+ *
+ * Trace layout (little-endian, cell-sized integers as int32):
+ *   header:  magic[8] | u32 version | u32 native count | { u16 name length | name | u8 variadic layout } * count
+ *   records: u16 native id | u16 amx id | u64 start (ns since trace start) | u32 duration (ns)
+ *            | i32 result | u8 result is handle | u32 argc | argument * argc
+ *   argument: u8 kind | payload
+ *            value, handle: i32
+ *            string: u32 length | bytes
+ *            ref: u8 flags | i32 value before call | i32 value after call
+ */
+class json_trace {
+public:
+  static constexpr char kMagic[8] = {'Y', 'A', 'P', 'J', 'T', 'R', 'C', '\0'};
+  static constexpr uint32_t kFormatVersion = 2; // 2: argc widened from u8 to u32
+  static constexpr size_t kFlushThreshold = 64 * 1024;
+
+  enum class arg_kind : uint8_t {
+    value,
+    handle,
+    string,
+    ref
+  };
+
+  enum class variadic_layout : uint8_t {
+    none,           // expanded native, arguments are described by its signature
+    refs,           // JsonNode:...
+    key_ref_pairs,  // {_, JsonNode}:...
+    node_format_outputs, // JsonNode:node, const format[], &...
+    node_format_inputs,  // JsonNode:node, const format[], ... (strings are recorded by value)
+    template_inputs      // JsonTemplate:template, output[], len, ... (strings are recorded by value)
+  };
+
+  enum ref_flags : uint8_t {
+    kRefInHandle = 1 << 0,
+    kRefOutHandle = 1 << 1,
+    kRefNull = 1 << 2
+  };
+
+  class call {
+    friend class json_trace;
+    struct pending_ref {
+      size_t offset;
+      const cell *value;
+    };
+    uint16_t native_id;
+    uint16_t amx_id;
+    uint32_t argc{0};
+    std::chrono::steady_clock::time_point started;
+    std::vector<char> args;
+    std::vector<pending_ref> refs;
+
+    template <typename T>
+    void put(const T value) {
+      auto bytes = reinterpret_cast<const char *>(&value);
+      args.insert(args.end(), bytes, bytes + sizeof(T));
+    }
+  public:
+    call(uint16_t native_id, uint16_t amx_id);
+
+    void value(const cell value);
+    void handle(const cell value);
+    void string(const std::string &value);
+    void ref(const cell *value, bool is_handle);
+    void null_ref();
+    void begin();
+  };
+
+  uint16_t declare(const char *name, variadic_layout layout);
+  uint16_t amx_id(AMX *amx);
+
+  call_result_t start(const std::filesystem::path &filename);
+  call_result_t stop();
+  bool is_active() const { return stream.is_open(); }
+
+  void write(call &record, const cell result, bool (*is_handle)(const cell));
+
+  template <auto func>
+  static inline uint16_t native_id{0};
+private:
+  struct native_entry {
+    std::string name;
+    variadic_layout layout;
+  };
+  std::vector<native_entry> natives;
+  std::unordered_map<AMX *, uint16_t> amx_ids;
+  std::ofstream stream;
+  std::vector<char> buffer;
+  std::chrono::steady_clock::time_point started;
+
+  void flush();
+};
+
+inline json_trace json_trace_instance;
@@ -34,6 +34,14 @@ struct native_param : script::NativeParam {
 
   operator char*() { return reinterpret_cast<char*>(script.GetPhysAddr(raw_value)); }
   operator node_ptr_t() { return reinterpret_cast<node_ptr_t>(raw_value); }
+  operator layout_ptr_t() { return reinterpret_cast<layout_ptr_t>(raw_value); }
+  operator validator_ptr_t() { return reinterpret_cast<validator_ptr_t>(raw_value); }
+  operator log_ptr_t() { return reinterpret_cast<log_ptr_t>(raw_value); }
+  operator lines_ptr_t() { return reinterpret_cast<lines_ptr_t>(raw_value); }
+  operator index_ptr_t() { return reinterpret_cast<index_ptr_t>(raw_value); }
+  operator snapshot_ptr_t() { return reinterpret_cast<snapshot_ptr_t>(raw_value); }
+  operator template_ptr_t() { return reinterpret_cast<template_ptr_t>(raw_value); }
+  operator cursor_ptr_t() { return reinterpret_cast<cursor_ptr_t>(raw_value); }
 
   operator node_ptr_t*() {
     if (raw_value == JSON_INVALID_NODE)
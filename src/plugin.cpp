@@ -22,15 +22,25 @@
 
 #include "plugin.h"
 
-#define REGISTER_NATIVE(name) RegisterNative<&script::name>(#name)
-#define REGISTER_NATIVE_EXPANDED(name) RegisterNative<&script::name, false>(#name)
+#define REGISTER_NATIVE(name) RegisterTracedNative<&script::name>(#name)
+#define REGISTER_NATIVE_EXPANDED(name, layout) RegisterTracedNative<&script::name, json_trace::variadic_layout::layout>(#name)
+#define REGISTER_NATIVE_UNTRACED(name) RegisterNative<&script::name>(#name)
 
 bool plugin::OnLoad() {
   REGISTER_NATIVE(JSON_Parse);
   REGISTER_NATIVE(JSON_ParseFile);
+  REGISTER_NATIVE(JSON_ParseFilesBatch);
   REGISTER_NATIVE(JSON_SaveFile);
+  REGISTER_NATIVE(JSON_SaveFilesBatch);
   REGISTER_NATIVE(JSON_Stringify);
+  REGISTER_NATIVE(JSON_StringifyBegin);
+  REGISTER_NATIVE(JSON_StringifyChunk);
+  REGISTER_NATIVE(JSON_StringifyEnd);
   REGISTER_NATIVE(JSON_Dump);
+  REGISTER_NATIVE(JSON_MemoryReport);
+  REGISTER_NATIVE(JSON_MemoryUsage);
+  REGISTER_NATIVE(JSON_GetMemoryStats);
+  REGISTER_NATIVE(JSON_SetMemoryQuota);
   REGISTER_NATIVE(JSON_NodeType);
 
   REGISTER_NATIVE(JSON_Null);
@@ -38,12 +48,17 @@ bool plugin::OnLoad() {
   REGISTER_NATIVE(JSON_Int);
   REGISTER_NATIVE(JSON_Float);
   REGISTER_NATIVE(JSON_String);
-  REGISTER_NATIVE_EXPANDED(JSON_Object);
-  REGISTER_NATIVE_EXPANDED(JSON_Array);
+  REGISTER_NATIVE_EXPANDED(JSON_Object, key_ref_pairs);
+  REGISTER_NATIVE_EXPANDED(JSON_Array, refs);
 
+  REGISTER_NATIVE(JSON_Clone);
   REGISTER_NATIVE(JSON_Append);
 //  REGISTER_NATIVE(JSON_Merge);
 
+  REGISTER_NATIVE(JSON_Diff);
+  REGISTER_NATIVE(JSON_ApplyPatch);
+  REGISTER_NATIVE(JSON_ApplyMergePatch);
+
   REGISTER_NATIVE(JSON_SetNull);
   REGISTER_NATIVE(JSON_SetBool);
   REGISTER_NATIVE(JSON_SetInt);
@@ -59,6 +74,25 @@ bool plugin::OnLoad() {
   REGISTER_NATIVE(JSON_GetObject);
   REGISTER_NATIVE(JSON_GetArray);
 
+  REGISTER_NATIVE(JSON_TryGetBool);
+  REGISTER_NATIVE(JSON_TryGetInt);
+  REGISTER_NATIVE(JSON_TryGetFloat);
+  REGISTER_NATIVE(JSON_TryGetString);
+
+  REGISTER_NATIVE_EXPANDED(JSON_GetMany, node_format_outputs);
+  REGISTER_NATIVE_EXPANDED(JSON_SetMany, node_format_inputs);
+  REGISTER_NATIVE(JSON_GetFieldErrors);
+
+  REGISTER_NATIVE(JSON_DefineLayout);
+  REGISTER_NATIVE(JSON_FromLayout);
+  REGISTER_NATIVE(JSON_ToLayout);
+
+  REGISTER_NATIVE(JSON_CompileSchema);
+  REGISTER_NATIVE(JSON_Validate);
+  REGISTER_NATIVE(JSON_DestroyValidator);
+
+  REGISTER_NATIVE(JSON_Query);
+
   REGISTER_NATIVE(JSON_GetType);
 
   REGISTER_NATIVE(JSON_ArrayLength);
@@ -72,14 +106,57 @@ bool plugin::OnLoad() {
   //REGISTER_NATIVE(JSON_Keys);
   REGISTER_NATIVE(JSON_Remove);
 
+  REGISTER_NATIVE(JSON_ArraySort);
+  REGISTER_NATIVE(JSON_ArrayFind);
+  REGISTER_NATIVE(JSON_ArrayBinarySearch);
+
+  REGISTER_NATIVE(JSON_CreateIndex);
+  REGISTER_NATIVE(JSON_IndexLookup);
+  REGISTER_NATIVE(JSON_IndexLookupInt);
+  REGISTER_NATIVE(JSON_IndexLookupString);
+  REGISTER_NATIVE(JSON_DestroyIndex);
+
+  REGISTER_NATIVE(JSON_SnapshotCreate);
+  REGISTER_NATIVE(JSON_SnapshotClone);
+  REGISTER_NATIVE(JSON_SnapshotGet);
+  REGISTER_NATIVE(JSON_SnapshotSet);
+  REGISTER_NATIVE(JSON_SnapshotRemove);
+  REGISTER_NATIVE(JSON_SnapshotDestroy);
+  REGISTER_NATIVE(JSON_SnapshotSave);
+  REGISTER_NATIVE(JSON_SnapshotDiff);
+
+  REGISTER_NATIVE(JSON_CompileTemplate);
+  REGISTER_NATIVE_EXPANDED(JSON_RenderTemplate, template_inputs);
+  REGISTER_NATIVE(JSON_DestroyTemplate);
+
   REGISTER_NATIVE(JSON_GetNodeBool);
   REGISTER_NATIVE(JSON_GetNodeInt);
   REGISTER_NATIVE(JSON_GetNodeFloat);
   REGISTER_NATIVE(JSON_GetNodeString);
 
+  REGISTER_NATIVE(JSON_GetRevision);
+  REGISTER_NATIVE(JSON_Hash);
+  REGISTER_NATIVE(JSON_Equal);
+
   REGISTER_NATIVE(JSON_StartWatcher);
   REGISTER_NATIVE(JSON_StopWatcher);
 
+  REGISTER_NATIVE(JSON_LogOpen);
+  REGISTER_NATIVE(JSON_LogAppend);
+  REGISTER_NATIVE(JSON_LogFlush);
+  REGISTER_NATIVE(JSON_LogClose);
+
+  REGISTER_NATIVE(JSON_LinesOpen);
+  REGISTER_NATIVE(JSON_LinesNext);
+  REGISTER_NATIVE(JSON_LinesRead);
+  REGISTER_NATIVE(JSON_LinesClose);
+
+  REGISTER_NATIVE(JSON_SetOption);
+  REGISTER_NATIVE(JSON_GetOption);
+
+  REGISTER_NATIVE_UNTRACED(JSON_StartTrace);
+  REGISTER_NATIVE_UNTRACED(JSON_StopTrace);
+
   REGISTER_NATIVE(JSON_Cleanup);
 
   Log("\n\n"
@@ -101,6 +178,8 @@ bool plugin::OnLoad() {
   return true;
 }
 #undef REGISTER_NATIVE
+#undef REGISTER_NATIVE_EXPANDED
+#undef REGISTER_NATIVE_UNTRACED
 
 const char *plugin::Name() {
   return "YAPJ";
@@ -110,6 +189,11 @@ int plugin::Version() {
   return JSON_VERSION;
 }
 
+void plugin::OnUnload() {
+  script::internal_JSON_CloseLogs();
+  json_trace_instance.stop();
+}
+
 void plugin::OnProcessTick() {
   plugin::EveryScript([=](auto &script) {
     return script->OnProcessTick();
@@ -31,5 +31,112 @@ public:
   const char *Name();
   int Version();
   bool OnLoad();
+  void OnUnload();
   void OnProcessTick();
+
+  template <auto func, json_trace::variadic_layout layout = json_trace::variadic_layout::none>
+  static void RegisterTracedNative(const char *name) {
+    json_trace::native_id<func> = json_trace_instance.declare(name, layout);
+    RegisterNative<&script::internal_JSON_TraceNative<func, layout>, false>(name);
+  }
 };
+
+template <typename T>
+constexpr bool is_handle_v = std::is_same_v<T, node_ptr_t> || std::is_same_v<T, layout_ptr_t>
+    || std::is_same_v<T, validator_ptr_t> || std::is_same_v<T, log_ptr_t> || std::is_same_v<T, lines_ptr_t>
+    || std::is_same_v<T, index_ptr_t> || std::is_same_v<T, snapshot_ptr_t> || std::is_same_v<T, template_ptr_t>
+    || std::is_same_v<T, cursor_ptr_t>;
+
+template <auto func>
+struct traced_native;
+
+template <typename RetT, typename... Args, RetT (script::*func)(Args...)>
+struct traced_native<func> {
+  template <typename T>
+  static void record_arg(script &scr, json_trace::call &record, const cell raw) {
+    using arg_t = std::remove_cv_t<T>;
+    if constexpr (is_handle_v<arg_t>) {
+      record.handle(raw);
+    } else if constexpr (std::is_same_v<arg_t, node_ptr_t *>) {
+      if (raw == JSON_INVALID_NODE) {
+        record.null_ref();
+      } else {
+        auto value = scr.GetPhysAddr(raw);
+        record.ref(value, script::internal_JSON_HandleExists(*value));
+      }
+    } else if constexpr (std::is_pointer_v<arg_t>) {
+      record.ref(scr.GetPhysAddr(raw), false);
+    } else if constexpr (std::is_same_v<arg_t, std::string> || std::is_same_v<arg_t, std::filesystem::path>) {
+      record.string(scr.GetString(raw));
+    } else {
+      record.value(raw);
+    }
+  }
+
+  template <size_t... I>
+  static cell invoke(script &scr, cell *params, std::index_sequence<I...>) {
+    return (scr.*func)(native_param{{scr, params[I + 1]}}...);
+  }
+
+  template <size_t... I>
+  static void record_args(script &scr, json_trace::call &record, cell *params, std::index_sequence<I...>) {
+    (record_arg<Args>(scr, record, params[I + 1]), ...);
+  }
+
+  static cell call(script &scr, cell *params) {
+    if (params[0] / sizeof(cell) != sizeof...(Args))
+      throw std::runtime_error{"number of parameters must be equal to " + std::to_string(sizeof...(Args))};
+    if (!json_trace_instance.is_active())
+      return invoke(scr, params, std::index_sequence_for<Args...>{});
+    json_trace::call record(json_trace::native_id<func>, json_trace_instance.amx_id(scr.GetAmx()));
+    record_args(scr, record, params, std::index_sequence_for<Args...>{});
+    record.begin();
+    auto result = invoke(scr, params, std::index_sequence_for<Args...>{});
+    json_trace_instance.write(record, result, script::internal_JSON_HandleExists);
+    return result;
+  }
+};
+
+template <auto func, json_trace::variadic_layout layout>
+cell script::internal_JSON_TraceNative(cell *params) {
+  if constexpr (layout == json_trace::variadic_layout::none) {
+    return traced_native<func>::call(*this, params);
+  } else {
+    if (!json_trace_instance.is_active())
+      return (this->*func)(params);
+    json_trace::call record(json_trace::native_id<func>, json_trace_instance.amx_id(GetAmx()));
+    constexpr bool has_format = layout == json_trace::variadic_layout::node_format_outputs
+        || layout == json_trace::variadic_layout::node_format_inputs;
+    constexpr bool has_template = layout == json_trace::variadic_layout::template_inputs;
+    const json_fields *spec = nullptr;
+    const json_template *tpl = has_template ? internal_JSON_FindTemplate(params[1]) : nullptr;
+    for (size_t i = 1; i <= params[0] / sizeof(cell); ++i) {
+      if (has_template && i == 1) {
+        record.handle(params[i]);
+      } else if (has_template && i == 3) {
+        record.value(params[i]);
+      } else if (has_template && i > 3 && tpl != nullptr && i - 4 < tpl->placeholders.size()
+          && tpl->placeholders[i - 4].type == json_template::argument_type::string) {
+        record.string(GetString(params[i]));
+      } else if (has_format && i == 1) {
+        record.handle(params[i]);
+      } else if (has_format && i == 2) {
+        auto format = GetString(params[i]);
+        spec = json_fields::get(format);
+        record.string(format);
+      } else if (layout == json_trace::variadic_layout::key_ref_pairs && i % 2 == 1) {
+        record.string(GetString(params[i]));
+      } else if (layout == json_trace::variadic_layout::node_format_inputs && spec != nullptr
+          && spec->argument_type(i - 3) == json_fields::field_type::string) {
+        record.string(GetString(params[i]));
+      } else {
+        auto value = GetPhysAddr(params[i]);
+        record.ref(value, internal_JSON_HandleExists(*value));
+      }
+    }
+    record.begin();
+    auto result = (this->*func)(params);
+    json_trace_instance.write(record, result, internal_JSON_HandleExists);
+    return result;
+  }
+}
@@ -22,12 +22,380 @@
 
 #include "script.h"
 #include <iostream>
+#include <cmath>
 
-#define PLUGIN_LOG(text, ...) Log("%s: %d: unknown error: " text, __FUNCTION__, __LINE__ __VA_OPT__(,) __VA_ARGS__)
-#define LOG_EXCEPTION(exc) Log("%s: %d: unknown exception: %s", __FUNCTION__, __LINE__, (exc).what())
-#define ASSERT_NODE_EXISTS(x) if ((x) == nullptr || valid_nodes.find((x)) == valid_nodes.cend()) { Log("%s: %d: error: node not exists", __FUNCTION__, __LINE__); return JSON_CALL_NODE_NOT_EXISTS_ERR; }
+// arguments are evaluated only if the message passes level and rate limit of its call site
+#define LOG_AT(level, text, ...) do { \
+    static json_diagnostics::call_site log_site_; \
+    uint32_t log_dropped_; \
+    if (json_diagnostics::enabled(level) && log_site_.allow(log_dropped_)) { \
+      if (log_dropped_ != 0) \
+        Log("%s: %d: %u similar messages suppressed", __FUNCTION__, __LINE__, log_dropped_); \
+      Log(text __VA_OPT__(,) __VA_ARGS__); \
+    } \
+  } while (false)
+#define PLUGIN_LOG(text, ...) LOG_AT(JSON_LOG_LEVEL_WARNING, "%s: %d: unknown error: " text, __FUNCTION__, __LINE__ __VA_OPT__(,) __VA_ARGS__)
+#define LOG_EXCEPTION(exc) LOG_AT(JSON_LOG_LEVEL_ERROR, "%s: %d: unknown exception: %s", __FUNCTION__, __LINE__, (exc).what())
+#define ASSERT_NODE_EXISTS_SHALLOW(x) if ((x) == nullptr || valid_nodes.find((x)) == valid_nodes.cend()) { LOG_AT(JSON_LOG_LEVEL_WARNING, "%s: %d: error: node not exists", __FUNCTION__, __LINE__); return JSON_CALL_NODE_NOT_EXISTS_ERR; }
+// natives which are not aware of lazily parsed objects get them fully parsed
+#define ASSERT_NODE_EXISTS(x) ASSERT_NODE_EXISTS_SHALLOW(x) internal_JSON_Materialize(x)
+// bytes is only evaluated when owner of the tree has a memory quota
+#define ASSERT_CAN_GROW(x, bytes) if (auto quota_script = internal_JSON_QuotaScript(x); quota_script != nullptr && !quota_script->internal_JSON_WithinQuota(bytes)) { return JSON_CALL_MEMORY_QUOTA_ERR; }
+#define ASSERT_NODES_DIFFER(x, y) if ((y) == (x) || (y) == internal_JSON_Owner(x)) { LOG_AT(JSON_LOG_LEVEL_WARNING, "%s: %d: error: node cannot be moved into itself", __FUNCTION__, __LINE__); return JSON_CALL_UNKNOWN_ERR; }
 
-inline std::unordered_set<node_ptr_t> valid_nodes;
+inline uint64_t node_generations{0};
+
+struct node_info {
+  uint64_t generation{++node_generations}; // unique per registration, unlike address which is reused after free
+  uint32_t revision{0};       // bumped by every mutating native
+  uint32_t saved_revision{0}; // revision at last successful JSON_SaveFile
+  std::string saved_path;
+  node_ptr_t owner{nullptr};          // set for borrowed handles, which point into owner's tree
+  std::vector<node_ptr_t> borrowed;   // borrowed handles into this node
+  std::vector<index_ptr_t> indexes;   // indexes over this node
+  script *owner_script{nullptr};      // script which allocated owned tree, nullptr if it came from another plugin
+  size_t bytes{0};                    // estimated size of owned tree at last accounting
+  uint64_t hash{0};                   // structural hash, valid while owner's revision equals hash_revision
+  uint32_t hash_revision{0};
+  bool hash_cached{false};
+  bool hash_comparable{true};         // see json_hash::compute
+};
+
+inline std::unordered_map<node_ptr_t, node_info> valid_nodes;
+inline std::unordered_map<node_ptr_t, std::unique_ptr<json_lazy>> lazy_nodes;
+
+// memory accounting of owned trees; sizes of new and changed trees are estimated lazily
+inline size_t total_memory_nodes{0};
+inline size_t total_memory_bytes{0};
+inline std::unordered_set<node_ptr_t> stale_nodes;
+
+inline void internal_JSON_AccountBytes(node_info &info, const size_t bytes) {
+  // unsigned wraparound makes the difference correct when tree has shrunk
+  total_memory_bytes += bytes - info.bytes;
+  if (info.owner_script != nullptr)
+    info.owner_script->memory_bytes += bytes - info.bytes;
+  info.bytes = bytes;
+}
+
+// lazily parsed object also holds its text
+inline size_t internal_JSON_EstimateBytes(const node_ptr_t node) {
+  auto bytes = json_memory_stats::estimate(*node);
+  if (!lazy_nodes.empty()) {
+    auto lazy = lazy_nodes.find(node);
+    if (lazy != lazy_nodes.end())
+      bytes += lazy->second->text_size();
+  }
+  return bytes;
+}
+
+inline void internal_JSON_RefreshMemory() {
+  for (auto node : stale_nodes)
+    internal_JSON_AccountBytes(valid_nodes.find(node)->second, internal_JSON_EstimateBytes(node));
+  stale_nodes.clear();
+}
+
+inline void internal_JSON_Materialize(const node_ptr_t node) {
+  if (lazy_nodes.empty())
+    return;
+  auto lazy = lazy_nodes.find(node);
+  if (lazy == lazy_nodes.end())
+    return;
+  lazy->second->materialize(*node);
+  lazy_nodes.erase(lazy);
+  stale_nodes.insert(node);
+}
+
+// registers owned tree; bytes is its size if already estimated, otherwise it is estimated on next refresh
+inline void internal_JSON_Adopt(const node_ptr_t node, script *owner_script, const std::optional<size_t> bytes = std::nullopt) {
+  auto &info = valid_nodes.try_emplace(node).first->second;
+  info.owner_script = owner_script;
+  ++total_memory_nodes;
+  if (owner_script != nullptr)
+    ++owner_script->memory_nodes;
+  if (bytes)
+    internal_JSON_AccountBytes(info, *bytes);
+  else
+    stale_nodes.insert(node);
+}
+
+inline node_ptr_t internal_JSON_Owner(const node_ptr_t node) {
+  auto info = valid_nodes.find(node);
+  return info != valid_nodes.cend() && info->second.owner != nullptr ? info->second.owner : node;
+}
+
+// script whose memory quota limits growth of the tree, nullptr if there is none
+inline script *internal_JSON_QuotaScript(const node_ptr_t node) {
+  auto owner_script = valid_nodes.find(internal_JSON_Owner(node))->second.owner_script;
+  return owner_script != nullptr && owner_script->memory_quota != 0 ? owner_script : nullptr;
+}
+
+// bytes which consuming value_node into the tree of node adds to the quota of the tree's script
+inline size_t internal_JSON_IncomingBytes(const node_ptr_t node, const node_ptr_t value_node) {
+  auto &value_info = valid_nodes.find(value_node)->second;
+  // owned tree of the same script only moves, its bytes are already counted
+  if (value_info.owner == nullptr && value_info.owner_script == valid_nodes.find(internal_JSON_Owner(node))->second.owner_script)
+    return 0;
+  return json_memory_stats::heap_size(*value_node);
+}
+
+// container and one member of an object, i.e. everything setting or removing the member changes
+inline size_t internal_JSON_MemberBytes(const nlohmann::ordered_json &object, const std::string &key) {
+  return json_memory_stats::container_size(object) + json_memory_stats::member_size(object, key);
+}
+
+// part of target changed by merging patch into it
+inline size_t internal_JSON_MergeBytes(const nlohmann::ordered_json &target, const nlohmann::ordered_json &patch) {
+  if (!target.is_object() || !patch.is_object())
+    return json_memory_stats::heap_size(target);
+  auto bytes = json_memory_stats::container_size(target);
+  for (auto item = patch.cbegin(); item != patch.cend(); ++item)
+    bytes += json_memory_stats::member_size(target, item.key());
+  return bytes;
+}
+
+/**
+ * Accounts a mutation by measuring the changed part of the tree before and after it, so that
+ * accounting costs as much as the change rather than a walk over the whole tree. Trees which
+ * wait for their first estimate are not measured.
+ * Growing the buffer of an object copies its members (keys are const, so members are not
+ * nothrow movable) and with them sizes of everything below; object which gets new members is
+ * passed as grown_object, and its tree is estimated again if the buffer was reallocated.
+ */
+class tree_resize {
+  node_ptr_t owner;
+  node_info *tree{nullptr};
+  const nlohmann::ordered_json *grown_object;
+  size_t before{0};
+  size_t object_before{0};
+public:
+  template <typename M>
+  tree_resize(const node_ptr_t node, M measure, const nlohmann::ordered_json *grown_object = nullptr)
+      : owner(internal_JSON_Owner(node)), grown_object(grown_object) {
+    if (stale_nodes.find(owner) != stale_nodes.end())
+      return;
+    tree = &valid_nodes.find(owner)->second;
+    before = measure();
+    if (grown_object != nullptr)
+      object_before = json_memory_stats::container_size(*grown_object);
+  }
+
+  // removed is size of what was measured before but is no longer part of the measured range
+  template <typename M>
+  void done(M measure, const size_t removed = 0) {
+    if (tree == nullptr)
+      return;
+    if (grown_object != nullptr && json_memory_stats::container_size(*grown_object) != object_before) {
+      stale_nodes.insert(owner);
+      return;
+    }
+    auto after = measure();
+    auto shrink = before + removed;
+    internal_JSON_AccountBytes(*tree, tree->bytes + after > shrink ? tree->bytes + after - shrink : 0);
+  }
+};
+
+// parses member of lazily parsed object, or drops it if forget is set because member is about to be replaced
+inline void internal_JSON_MaterializeMember(const node_ptr_t node, const std::string &key, const bool forget = false) {
+  if (lazy_nodes.empty())
+    return;
+  auto lazy = lazy_nodes.find(node);
+  if (lazy == lazy_nodes.end())
+    return;
+  auto member_bytes = [&] { return json_memory_stats::member_size(*node, key); };
+  tree_resize resize(node, member_bytes);
+  if (forget)
+    lazy->second->forget(key);
+  else
+    lazy->second->materialize(*node, key);
+  size_t text_size = 0;
+  if (lazy->second->done()) {
+    text_size = lazy->second->text_size();
+    lazy_nodes.erase(lazy);
+  }
+  resize.done(member_bytes, text_size);
+}
+
+// owner's revision is bumped by changes made through any handle into the tree, so it guards cached hashes of borrowed handles too
+inline uint64_t internal_JSON_Hash(const node_ptr_t node) {
+  auto &info = valid_nodes.find(node)->second;
+  auto revision = info.owner != nullptr ? valid_nodes.find(info.owner)->second.revision : info.revision;
+  if (!info.hash_cached || info.hash_revision != revision) {
+    info.hash_comparable = true;
+    info.hash = json_hash::compute(*node, info.hash_comparable);
+    info.hash_revision = revision;
+    info.hash_cached = true;
+  }
+  return info.hash;
+}
+
+// whether hashes prove the trees differ, which only holds if both hashes agree with operator==
+inline bool internal_JSON_HashesDiffer(const node_ptr_t node, const node_ptr_t other) {
+  if (internal_JSON_Hash(node) == internal_JSON_Hash(other))
+    return false;
+  return valid_nodes.find(node)->second.hash_comparable && valid_nodes.find(other)->second.hash_comparable;
+}
+
+// O(1) rejection of values which cannot compare equal; numbers of different types still may
+inline bool internal_JSON_MayEqual(const nlohmann::ordered_json &left, const nlohmann::ordered_json &right) {
+  if (left.is_number() && right.is_number())
+    return true;
+  if (left.type() != right.type())
+    return false;
+  if (left.is_string())
+    return left.get_ref<const std::string &>().size() == right.get_ref<const std::string &>().size();
+  return !left.is_structured() || left.size() == right.size();
+}
+
+// single scan of object members instead of contains() followed by operator[]
+inline nlohmann::ordered_json *internal_JSON_FindMember(const node_ptr_t node, const std::string &key) {
+  if (!node->is_object())
+    return nullptr;
+  internal_JSON_MaterializeMember(node, key);
+  auto item = node->find(key);
+  return item != node->end() ? &*item : nullptr;
+}
+
+inline void internal_JSON_DropBorrowed(node_info &info) {
+  for (auto borrowed : info.borrowed)
+    valid_nodes.erase(borrowed);
+  info.borrowed.clear();
+}
+
+// indexes_updated is passed by array natives which have already updated indexes of node
+inline void internal_JSON_Touch(const node_ptr_t node, const bool indexes_updated = false) {
+  auto &info = valid_nodes.find(node)->second;
+  ++info.revision;
+  if (info.owner != nullptr) {
+    // element was changed in place: handles into owner stay valid, but indexed values may have changed
+    auto &owner_info = valid_nodes.find(info.owner)->second;
+    ++owner_info.revision;
+    for (auto index : owner_info.indexes)
+      index->invalidate();
+    return;
+  }
+  // elements may have moved
+  internal_JSON_DropBorrowed(info);
+  if (!indexes_updated) {
+    for (auto index : info.indexes)
+      index->invalidate();
+  }
+}
+
+template <typename F>
+inline void internal_JSON_UpdateIndexes(const node_ptr_t node, const std::string &array_key, F update) {
+  for (auto index : valid_nodes.find(node)->second.indexes) {
+    if (index->indexed_array_key() == array_key)
+      update(*index);
+  }
+}
+
+inline std::unordered_map<index_ptr_t, std::unique_ptr<json_index>> valid_indexes;
+inline std::unordered_map<snapshot_ptr_t, std::unique_ptr<json_persistent>> valid_snapshots;
+inline std::unordered_map<template_ptr_t, std::unique_ptr<json_template>> valid_templates;
+
+struct stringify_cursor {
+  std::unique_ptr<json_stringifier> stringifier;
+  node_ptr_t root;    // handle owning the tree, its revision covers changes made through borrowed handles
+  uint64_t generation; // tells root apart from a tree allocated at the same address after root was released
+  uint32_t revision;
+};
+inline std::unordered_map<cursor_ptr_t, stringify_cursor> valid_cursors;
+
+// Drops handle and everything attached to it. Returns the tree it owned, nullptr for borrowed handles
+inline node_ptr_t internal_JSON_Unregister(std::unordered_map<node_ptr_t, node_info>::iterator node_iter) {
+  auto node = node_iter->first;
+  auto &info = node_iter->second;
+  if (info.owner != nullptr) {
+    // borrowed handle does not own its tree
+    auto &borrowed = valid_nodes.find(info.owner)->second.borrowed;
+    borrowed.erase(std::find(borrowed.begin(), borrowed.end(), node));
+    valid_nodes.erase(node_iter);
+    return nullptr;
+  }
+  internal_JSON_DropBorrowed(info);
+  for (auto index : info.indexes)
+    valid_indexes.erase(index);
+  lazy_nodes.erase(node);
+  internal_JSON_AccountBytes(info, 0);
+  --total_memory_nodes;
+  if (info.owner_script != nullptr)
+    --info.owner_script->memory_nodes;
+  stale_nodes.erase(node);
+  valid_nodes.erase(node_iter);
+  return node;
+}
+inline std::unordered_set<layout_ptr_t> valid_layouts;
+inline std::unordered_map<validator_ptr_t, std::unique_ptr<json_schema>> valid_validators;
+inline std::unordered_map<log_ptr_t, std::unique_ptr<json_log>> valid_logs;
+inline std::unordered_map<lines_ptr_t, std::unique_ptr<json_lines>> valid_readers;
+
+inline std::string internal_JSON_ReadString(const cell *src, size_t max_length) {
+  std::string result;
+  if (static_cast<ucell>(*src) > UNPACKEDMAX) {
+    // packed characters fill each cell from its most significant byte down, like amx_GetString reads them
+    for (size_t i = 0; i < max_length * sizeof(cell); ++i) {
+      auto ch = static_cast<char>(static_cast<ucell>(src[i / sizeof(cell)]) >> ((sizeof(cell) - 1 - i % sizeof(cell)) * 8));
+      if (ch == '\0')
+        break;
+      result.push_back(ch);
+    }
+  } else {
+    for (size_t i = 0; i < max_length && src[i] != 0; ++i)
+      result.push_back(static_cast<char>(src[i]));
+  }
+  return result;
+}
+
+inline std::vector<std::string> internal_JSON_SplitKeyPath(const std::string &key_path) {
+  std::vector<std::string> keys;
+  if (key_path.empty())
+    return keys;
+  size_t start = 0, end;
+  while ((end = key_path.find('.', start)) != std::string::npos) {
+    keys.push_back(key_path.substr(start, end - start));
+    start = end + 1;
+  }
+  keys.push_back(key_path.substr(start));
+  return keys;
+}
+
+inline const nlohmann::ordered_json &internal_JSON_ResolveKeyPath(const nlohmann::ordered_json &item, const std::vector<std::string> &keys) {
+  static const nlohmann::ordered_json null_value;
+  auto current = &item;
+  for (const auto &key : keys) {
+    if (!current->is_object())
+      return null_value;
+    auto child = current->find(key);
+    if (child == current->end())
+      return null_value;
+    current = &*child;
+  }
+  return *current;
+}
+
+// operator< of json is not a strict weak ordering once NaN is involved, which sorting relies on;
+// here NaN is greater than every other number and equal to itself, containers compare element-wise
+inline bool internal_JSON_SortLess(const nlohmann::ordered_json &a, const nlohmann::ordered_json &b) {
+  if (a.is_number() && b.is_number()) {
+    auto a_nan = a.is_number_float() && std::isnan(a.get<double>());
+    auto b_nan = b.is_number_float() && std::isnan(b.get<double>());
+    if (a_nan || b_nan)
+      return !a_nan;
+    return a < b;
+  }
+  if (a.is_array() && b.is_array())
+    return std::lexicographical_compare(a.cbegin(), a.cend(), b.cbegin(), b.cend(), internal_JSON_SortLess);
+  if (a.is_object() && b.is_object()) {
+    const auto &a_members = a.get_ref<const nlohmann::ordered_json::object_t &>();
+    const auto &b_members = b.get_ref<const nlohmann::ordered_json::object_t &>();
+    return std::lexicographical_compare(a_members.cbegin(), a_members.cend(), b_members.cbegin(), b_members.cend(), [](const auto &x, const auto &y) {
+      if (x.first != y.first)
+        return x.first < y.first;
+      return internal_JSON_SortLess(x.second, y.second);
+    });
+  }
+  return a < b;
+}
 
 inline node_type_t internal_JSON_NodeType(const node_ptr_t node) {
   using value_t = nlohmann::ordered_json::value_t;
@@ -48,13 +416,19 @@ inline node_type_t internal_JSON_NodeType(const node_ptr_t node) {
   }
 }
 
-call_result_t script::JSON_Parse(const std::string buffer, node_ptr_t *node) {
+call_result_t script::JSON_Parse(const std::string buffer, node_ptr_t *node, const bool lazy) {
   if (node == nullptr)
     return JSON_CALL_NODE_NOT_EXISTS_ERR;
   try {
+    // parsed tree is never smaller than its text, so oversized buffer is rejected before parsing
+    if (!internal_JSON_WithinQuota(buffer.size()))
+      return JSON_CALL_MEMORY_QUOTA_ERR;
+    if (lazy)
+      return internal_JSON_ParseLazy(iconvlite::cp2utf(buffer), node);
     JSON_Cleanup(*node);
     *node = new nlohmann::ordered_json(nlohmann::ordered_json::parse(iconvlite::cp2utf(buffer)));
-    valid_nodes.insert(*node);
+    if (!internal_JSON_Track(*node))
+      return JSON_CALL_MEMORY_QUOTA_ERR;
     return JSON_CALL_NO_ERR;
   } catch (const std::exception &e) {
     LOG_EXCEPTION(e);
@@ -62,17 +436,22 @@ call_result_t script::JSON_Parse(const std::string buffer, node_ptr_t *node) {
   }
 }
 
-call_result_t script::JSON_ParseFile(const std::filesystem::path filename, node_ptr_t *node) {
+call_result_t script::JSON_ParseFile(const std::filesystem::path filename, node_ptr_t *node, const bool lazy) {
   if (node == nullptr)
     return JSON_CALL_NODE_NOT_EXISTS_ERR;
   try {
     if (!exists(filename) || !is_regular_file(filename)) {
       return JSON_CALL_NO_SUCH_FILE_ERR;
     }
-    std::ifstream f(filename);
+    if (!internal_JSON_WithinQuota(file_size(filename)))
+      return JSON_CALL_MEMORY_QUOTA_ERR;
+    if (lazy)
+      return internal_JSON_ParseLazy(json_file_reader::read(filename), node);
+    auto value = json_file_reader::parse(filename);
     JSON_Cleanup(*node);
-    *node = new nlohmann::ordered_json(nlohmann::ordered_json::parse(f));
-    valid_nodes.insert(*node);
+    *node = new nlohmann::ordered_json(std::move(value));
+    if (!internal_JSON_Track(*node))
+      return JSON_CALL_MEMORY_QUOTA_ERR;
     return JSON_CALL_NO_ERR;
   } catch (const std::exception &e) {
     LOG_EXCEPTION(e);
@@ -80,19 +459,120 @@ call_result_t script::JSON_ParseFile(const std::filesystem::path filename, node_
   }
 }
 
-call_result_t script::JSON_SaveFile(const std::filesystem::path filename, const node_ptr_t node, const cell indent) {
+call_result_t script::JSON_ParseFilesBatch(const cell *paths, const cell count, cell *nodes, const cell path_size, const cell paths_count, const cell nodes_size) {
+  if (count < 0 || path_size <= 0) {
+    PLUGIN_LOG("Invalid count or path size");
+    return JSON_CALL_FORMAT_ERR;
+  }
+  // rows are found through offsets stored in the array and nodes are overwritten, so count must fit both
+  if (count > paths_count || count > nodes_size) {
+    PLUGIN_LOG("Count %d exceeds size of paths (%d) or nodes (%d) array", count, paths_count, nodes_size);
+    return JSON_CALL_FORMAT_ERR;
+  }
+  std::vector<json_file_reader::batch_item> items(count);
+  for (cell i = 0; i < count; ++i) {
+    // two-dimensional array starts with offsets in bytes from each cell to its row
+    auto row = reinterpret_cast<const cell *>(reinterpret_cast<const char *>(paths + i) + paths[i]);
+    // rows may be packed strings, which internal_JSON_ReadString decodes in Pawn byte order
+    items[i].filename = internal_JSON_ReadString(row, path_size);
+  }
+  json_file_reader::parse_batch(items);
+  // handles are registered on the main thread only
+  auto result = JSON_CALL_NO_ERR;
+  for (cell i = 0; i < count; ++i) {
+    auto &item = items[i];
+    auto node = reinterpret_cast<node_ptr_t *>(&nodes[i]);
+    JSON_Cleanup(*node);
+    *node = nullptr;
+    if (item.result == JSON_CALL_NO_ERR) {
+      *node = new nlohmann::ordered_json(std::move(item.value));
+      if (!internal_JSON_Track(*node))
+        item.result = JSON_CALL_MEMORY_QUOTA_ERR;
+    } else {
+      LOG_AT(JSON_LOG_LEVEL_ERROR, "%s: %d: '%s': %s", __FUNCTION__, __LINE__, item.filename.string().c_str(), item.error.c_str());
+    }
+    if (result == JSON_CALL_NO_ERR)
+      result = item.result;
+  }
+  return result;
+}
+
+call_result_t script::JSON_SaveFilesBatch(const cell *nodes, const cell *paths, const cell count, cell *results, const cell indent, const cell compression, const cell path_size, const cell nodes_size, const cell paths_count, const cell results_size) {
+  if (count < 0 || path_size <= 0) {
+    PLUGIN_LOG("Invalid count or path size");
+    return JSON_CALL_FORMAT_ERR;
+  }
+  if (count > nodes_size || count > paths_count || count > results_size) {
+    PLUGIN_LOG("Count %d exceeds size of nodes (%d), paths (%d) or results (%d) array", count, nodes_size, paths_count, results_size);
+    return JSON_CALL_FORMAT_ERR;
+  }
+  if (compression < JSON_COMPRESSION_AUTO || compression >= JSON_COMPRESSION_MAX)
+    return JSON_CALL_INVALID_OPTION_ERR;
+  std::vector<json_file_writer::batch_item> items(count);
+  for (cell i = 0; i < count; ++i) {
+    auto &item = items[i];
+    auto node = reinterpret_cast<node_ptr_t>(nodes[i]);
+    auto row = reinterpret_cast<const cell *>(reinterpret_cast<const char *>(paths + i) + paths[i]);
+    // rows may be packed strings, which internal_JSON_ReadString decodes in Pawn byte order
+    item.filename = internal_JSON_ReadString(row, path_size);
+    if (node == nullptr || valid_nodes.find(node) == valid_nodes.cend()) {
+      item.result = JSON_CALL_NODE_NOT_EXISTS_ERR;
+      item.error = "node not exists";
+      continue;
+    }
+    // workers only read trees, so lazily parsed ones are completed here
+    internal_JSON_Materialize(node);
+    item.node = node;
+  }
+  json_file_writer::save_batch(items, indent, static_cast<JsonCompression>(compression));
+  auto result = JSON_CALL_NO_ERR;
+  for (cell i = 0; i < count; ++i) {
+    auto &item = items[i];
+    results[i] = item.result;
+    if (item.result == JSON_CALL_NO_ERR) {
+      auto &info = valid_nodes.find(reinterpret_cast<node_ptr_t>(nodes[i]))->second;
+      info.saved_revision = info.revision;
+      info.saved_path = item.filename.string();
+    } else {
+      LOG_AT(JSON_LOG_LEVEL_ERROR, "%s: %d: '%s': %s", __FUNCTION__, __LINE__, item.filename.string().c_str(), item.error.c_str());
+      if (result == JSON_CALL_NO_ERR)
+        result = item.result;
+    }
+  }
+  return result;
+}
+
+call_result_t script::internal_JSON_ParseLazy(std::string text, node_ptr_t *node) {
+  nlohmann::ordered_json root;
+  auto lazy = json_lazy::parse(std::move(text), root);
+  JSON_Cleanup(*node);
+  *node = new nlohmann::ordered_json(std::move(root));
+  // registered before tracking so that its text is accounted too
+  if (lazy != nullptr && !lazy->done())
+    lazy_nodes.emplace(*node, std::move(lazy));
+  if (!internal_JSON_Track(*node))
+    return JSON_CALL_MEMORY_QUOTA_ERR;
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t script::JSON_SaveFile(const std::filesystem::path filename, const node_ptr_t node, const cell indent, const bool skip_unchanged, const cell compression) {
   ASSERT_NODE_EXISTS(node);
+  if (compression < JSON_COMPRESSION_AUTO || compression >= JSON_COMPRESSION_MAX)
+    return JSON_CALL_INVALID_OPTION_ERR;
   try {
-    auto parent_path = filename.parent_path();
-    if (!parent_path.empty()) {
-      if (!exists(parent_path)) {
-        create_directories(filename.parent_path());
-      } else if (!is_directory(filename.parent_path())) {
-        return JSON_CALL_NO_SUCH_DIR_ERR;
-      }
+    auto &info = valid_nodes.find(node)->second;
+    auto path = filename.string();
+    if (skip_unchanged && info.saved_revision == info.revision && info.saved_path == path && exists(filename)) {
+      return JSON_CALL_NO_ERR;
     }
-    std::ofstream o(filename, std::ofstream::trunc);
-    o << node->dump(indent) << std::endl;
+    auto result = json_file_writer::save_file(filename, *node, indent, static_cast<JsonCompression>(compression));
+    if (result != JSON_CALL_NO_ERR) {
+      if (result == JSON_CALL_UNKNOWN_ERR)
+        LOG_AT(JSON_LOG_LEVEL_ERROR, "%s: %d: error: could not write file '%s'", __FUNCTION__, __LINE__, path.c_str());
+      return result;
+    }
+    info.saved_revision = info.revision;
+    info.saved_path = std::move(path);
     return JSON_CALL_NO_ERR;
   } catch (const std::exception &e) {
     LOG_EXCEPTION(e);
@@ -112,12 +592,89 @@ call_result_t script::JSON_Stringify(const node_ptr_t node, cell *out, const cel
   }
 }
 
+call_result_t script::JSON_StringifyBegin(const node_ptr_t node, const cell indent, cell *cursor) {
+  ASSERT_NODE_EXISTS(node);
+  auto root = internal_JSON_Owner(node);
+  auto stringifier = std::make_unique<json_stringifier>(*node, indent);
+  auto ptr = stringifier.get();
+  auto &root_info = valid_nodes.find(root)->second;
+  valid_cursors.emplace(ptr, stringify_cursor{std::move(stringifier), root, root_info.generation, root_info.revision});
+  *cursor = reinterpret_cast<cell>(ptr);
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t script::JSON_StringifyChunk(const cursor_ptr_t cursor, cell *out, cell *length, const cell out_size) {
+  auto item = valid_cursors.find(cursor);
+  if (item == valid_cursors.cend())
+    return JSON_CALL_NO_SUCH_CURSOR_ERR;
+  auto &state = item->second;
+  auto root = valid_nodes.find(state.root);
+  if (root == valid_nodes.cend() || root->second.generation != state.generation || root->second.revision != state.revision) {
+    PLUGIN_LOG("Node was modified or released while being stringified");
+    return JSON_CALL_STALE_CURSOR_ERR;
+  }
+  if (out_size <= 1)
+    return JSON_CALL_NO_RETURN_STRING_ERR;
+  // reused so that draining a large document does not allocate per chunk
+  static std::string chunk;
+  chunk.clear();
+  *length = static_cast<cell>(state.stringifier->next(chunk, static_cast<size_t>(out_size) - 1));
+  SetString(out, chunk, out_size);
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t script::JSON_StringifyEnd(const cursor_ptr_t cursor) {
+  if (valid_cursors.erase(cursor) == 0)
+    return JSON_CALL_NO_SUCH_CURSOR_ERR;
+  return JSON_CALL_NO_ERR;
+}
+
 call_result_t script::JSON_Dump(const node_ptr_t node, const cell indent) {
   ASSERT_NODE_EXISTS(node);
   std::cout << node->dump(indent) << std::endl;
   return JSON_CALL_NO_ERR;
 }
 
+call_result_t script::JSON_MemoryReport(const node_ptr_t node) {
+  json_memory_stats stats;
+  if (node != nullptr) {
+    ASSERT_NODE_EXISTS_SHALLOW(node);
+    stats.add(*node);
+  }
+  else {
+    for (auto &[item, info] : valid_nodes) {
+      // borrowed handles point into trees which are already counted
+      if (info.owner == nullptr)
+        stats.add(*item);
+    }
+  }
+  Log("JSON memory: %zu values (%zu objects, %zu arrays, %zu strings), ~%zu bytes",
+      stats.values, stats.objects, stats.arrays, stats.strings, stats.bytes);
+  Log("JSON memory: %zu keys (%zu distinct), %zu key heap bytes, %zu of them held by duplicate keys",
+      stats.members, stats.distinct_keys(), stats.key_bytes, stats.duplicate_key_bytes);
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t script::JSON_MemoryUsage(const node_ptr_t node, cell *bytes) {
+  ASSERT_NODE_EXISTS_SHALLOW(node);
+  *bytes = static_cast<cell>(internal_JSON_EstimateBytes(node));
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t script::JSON_GetMemoryStats(cell *nodes, cell *bytes, const bool plugin_wide) {
+  internal_JSON_RefreshMemory();
+  *nodes = static_cast<cell>(plugin_wide ? total_memory_nodes : memory_nodes);
+  *bytes = static_cast<cell>(plugin_wide ? total_memory_bytes : memory_bytes);
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t script::JSON_SetMemoryQuota(const cell bytes) {
+  if (bytes < 0)
+    return JSON_CALL_INVALID_OPTION_ERR;
+  memory_quota = static_cast<size_t>(bytes);
+  return JSON_CALL_NO_ERR;
+}
+
 node_type_t script::JSON_NodeType(const node_ptr_t node) {
   ASSERT_NODE_EXISTS(node);
   return internal_JSON_NodeType(node);
@@ -126,7 +683,8 @@ node_type_t script::JSON_NodeType(const node_ptr_t node) {
 template<typename T>
 node_ptr_result_t script::internal_JSON_ConstructNode(T value) {
   auto ptr = new nlohmann::ordered_json(value);
-  valid_nodes.insert(ptr);
+  if (!internal_JSON_Track(ptr))
+    return JSON_INVALID_NODE;
   return reinterpret_cast<node_ptr_result_t>(ptr);
 }
 
@@ -156,37 +714,46 @@ node_ptr_result_t script::JSON_Object(const cell *params) {
     return 0;
   }
   auto obj = new nlohmann::ordered_json(nlohmann::ordered_json::object());
-  valid_nodes.insert(obj);
   size_t pairs = params[0] / sizeof(cell) / 2;
   for (size_t i = 0; i < pairs; ++i) {
     auto pair_ptr = params + (1 + (i * 2));
     auto key = GetString(*pair_ptr);
     auto item = *reinterpret_cast<node_ptr_t *>(GetPhysAddr(*(++pair_ptr)));
-    if (item == nullptr || std::find(valid_nodes.cbegin(), valid_nodes.cend(), item) == valid_nodes.cend())
+    if (item == nullptr || valid_nodes.find(item) == valid_nodes.cend())
       continue;
-    (*obj)[key] = *item;
-    JSON_Cleanup(item);
+    (*obj)[key] = internal_JSON_Consume(item);
   }
+  // consumed items have released their bytes, so only copies of borrowed ones can exceed the quota
+  if (!internal_JSON_Track(obj))
+    return JSON_INVALID_NODE;
   return reinterpret_cast<node_ptr_result_t>(obj);
 }
 
 node_ptr_result_t script::JSON_Array(cell *params) {
   auto arr = new nlohmann::ordered_json(nlohmann::ordered_json::array());
-  valid_nodes.insert(arr);
   for (size_t i = 1; i <= params[0] / sizeof(cell); ++i) {
     auto item = *reinterpret_cast<node_ptr_t *>(GetPhysAddr(params[i]));
-    if (item == nullptr || std::find(valid_nodes.cbegin(), valid_nodes.cend(), item) == valid_nodes.cend())
+    if (item == nullptr || valid_nodes.find(item) == valid_nodes.cend())
       continue;
-    arr->emplace_back(*item);
-    JSON_Cleanup(item);
+    arr->emplace_back(internal_JSON_Consume(item));
   }
+  if (!internal_JSON_Track(arr))
+    return JSON_INVALID_NODE;
   return reinterpret_cast<node_ptr_result_t>(arr);
 }
 
+node_ptr_result_t script::JSON_Clone(const node_ptr_t node) {
+  if (node == nullptr || valid_nodes.find(node) == valid_nodes.cend())
+    return JSON_INVALID_NODE;
+  internal_JSON_Materialize(node);
+  return internal_JSON_ConstructNode(*node);
+}
+
 node_ptr_result_t script::JSON_Append(const node_ptr_t first_node, const node_ptr_t second_node) {
   // TODO: Returning errors from this method is ambiguous
   ASSERT_NODE_EXISTS(first_node);
   ASSERT_NODE_EXISTS(second_node);
+  ASSERT_NODES_DIFFER(first_node, second_node);
   if (!first_node->is_object() && !first_node->is_array()) {
     PLUGIN_LOG("First array type does not equal to required one");
     return JSON_CALL_WRONG_TYPE_ERR;
@@ -195,22 +762,95 @@ node_ptr_result_t script::JSON_Append(const node_ptr_t first_node, const node_pt
     PLUGIN_LOG("Second array type does not equal to first one");
     return JSON_CALL_WRONG_TYPE_ERR;
   }
-  auto copy_first_node = new nlohmann::ordered_json(*first_node);
-  valid_nodes.insert(copy_first_node);
-  if (copy_first_node->is_object()) {
-    copy_first_node->merge_patch(*second_node);
+  if (auto quota_script = internal_JSON_QuotaScript(first_node); quota_script != nullptr
+      && !quota_script->internal_JSON_WithinQuota(internal_JSON_IncomingBytes(first_node, second_node)
+          + json_memory_stats::insert_growth(*first_node, second_node->size())))
+    return JSON_INVALID_NODE;
+  // first node is reused as the result, so neither tree is copied
+  auto result = first_node;
+  if (valid_nodes.find(first_node)->second.owner != nullptr) {
+    result = reinterpret_cast<node_ptr_t>(internal_JSON_ConstructNode(internal_JSON_Consume(first_node)));
+    if (result == nullptr)
+      return JSON_INVALID_NODE;
+  }
+  auto second = internal_JSON_Consume(second_node);
+  if (result->is_object()) {
+    auto merged_bytes = [&] { return internal_JSON_MergeBytes(*result, second); };
+    tree_resize resize(result, merged_bytes, result);
+    result->merge_patch(second);
+    resize.done(merged_bytes);
   } else {
-    copy_first_node->insert(copy_first_node->end(), second_node->begin(), second_node->end());
+    auto &items = result->get_ref<nlohmann::ordered_json::array_t &>();
+    auto &appended = second.get_ref<nlohmann::ordered_json::array_t &>();
+    auto offset = items.size();
+    tree_resize resize(result, [&] { return json_memory_stats::container_size(*result); });
+    items.insert(items.end(), std::make_move_iterator(appended.begin()), std::make_move_iterator(appended.end()));
+    resize.done([&] {
+      auto bytes = json_memory_stats::container_size(*result);
+      for (auto item = items.cbegin() + offset; item != items.cend(); ++item)
+        bytes += json_memory_stats::heap_size(*item);
+      return bytes;
+    });
   }
-  JSON_Cleanup(first_node);
-  JSON_Cleanup(second_node);
-  return reinterpret_cast<node_ptr_result_t>(copy_first_node);
+  internal_JSON_Touch(result);
+  return reinterpret_cast<node_ptr_result_t>(result);
+}
+
+call_result_t script::JSON_Diff(const node_ptr_t first_node, const node_ptr_t second_node, node_ptr_t *patch) {
+  ASSERT_NODE_EXISTS(first_node);
+  ASSERT_NODE_EXISTS(second_node);
+  if (patch == nullptr)
+    return JSON_CALL_NODE_NOT_EXISTS_ERR;
+  auto diff = new nlohmann::ordered_json(nlohmann::ordered_json::diff(*first_node, *second_node));
+  JSON_Cleanup(*patch);
+  *patch = diff;
+  if (!internal_JSON_Track(*patch))
+    return JSON_CALL_MEMORY_QUOTA_ERR;
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t script::JSON_ApplyPatch(node_ptr_t node, const node_ptr_t patch) {
+  ASSERT_NODE_EXISTS(node);
+  ASSERT_NODE_EXISTS(patch);
+  try {
+    // patching copies the whole tree anyway, so whole sizes are measured
+    auto patched = node->patch(*patch);
+    auto node_bytes = [&] { return json_memory_stats::heap_size(*node); };
+    ASSERT_CAN_GROW(node, std::max<ptrdiff_t>(0, static_cast<ptrdiff_t>(json_memory_stats::heap_size(patched)) - static_cast<ptrdiff_t>(node_bytes())));
+    tree_resize resize(node, node_bytes);
+    *node = std::move(patched);
+    resize.done(node_bytes);
+    internal_JSON_Touch(node);
+    return JSON_CALL_NO_ERR;
+  } catch (const std::exception &e) {
+    LOG_EXCEPTION(e);
+    return JSON_CALL_PATCH_ERR;
+  }
+}
+
+call_result_t script::JSON_ApplyMergePatch(node_ptr_t node, const node_ptr_t patch) {
+  ASSERT_NODE_EXISTS(node);
+  ASSERT_NODE_EXISTS(patch);
+  ASSERT_CAN_GROW(node, json_memory_stats::heap_size(*patch) + json_memory_stats::insert_growth(*node, patch->is_object() ? patch->size() : 0));
+  auto merged_bytes = [&] { return internal_JSON_MergeBytes(*node, *patch); };
+  tree_resize resize(node, merged_bytes, node);
+  node->merge_patch(*patch);
+  resize.done(merged_bytes);
+  internal_JSON_Touch(node);
+  return JSON_CALL_NO_ERR;
 }
 
 template<typename T>
 call_result_t script::internal_JSON_SetValue(node_ptr_t node, const std::string key, const T value) {
-  ASSERT_NODE_EXISTS(node);
-  (*node)[key] = value;
+  ASSERT_NODE_EXISTS_SHALLOW(node);
+  internal_JSON_MaterializeMember(node, key, true);
+  nlohmann::ordered_json item = value;
+  ASSERT_CAN_GROW(node, json_memory_stats::heap_size(item) + json_memory_stats::key_heap_size(key) + json_memory_stats::insert_growth(*node));
+  auto member_bytes = [&] { return internal_JSON_MemberBytes(*node, key); };
+  tree_resize resize(node, member_bytes, node);
+  (*node)[key] = std::move(item);
+  resize.done(member_bytes);
+  internal_JSON_Touch(node);
   return JSON_CALL_NO_ERR;
 }
 
@@ -234,31 +874,37 @@ call_result_t script::JSON_SetString(node_ptr_t node, const std::string key, con
   return internal_JSON_SetValue(node, key, iconvlite::cp2utf(value));
 }
 
-call_result_t script::JSON_SetObject(node_ptr_t node, const std::string key, const node_ptr_t value_node) {
+call_result_t script::internal_JSON_MoveValue(node_ptr_t node, const std::string key, const node_ptr_t value_node) {
+  ASSERT_NODE_EXISTS_SHALLOW(node);
   ASSERT_NODE_EXISTS(value_node);
-  auto result = internal_JSON_SetValue(node, key, *value_node);
-  if (result == JSON_CALL_NO_ERR) {
-    JSON_Cleanup(value_node);
-  }
-  return result;
+  ASSERT_NODES_DIFFER(node, value_node);
+  internal_JSON_MaterializeMember(node, key, true);
+  ASSERT_CAN_GROW(node, internal_JSON_IncomingBytes(node, value_node) + json_memory_stats::key_heap_size(key) + json_memory_stats::insert_growth(*node));
+  auto value = internal_JSON_Consume(value_node);
+  auto member_bytes = [&] { return internal_JSON_MemberBytes(*node, key); };
+  tree_resize resize(node, member_bytes, node);
+  (*node)[key] = std::move(value);
+  resize.done(member_bytes);
+  internal_JSON_Touch(node);
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t script::JSON_SetObject(node_ptr_t node, const std::string key, const node_ptr_t value_node) {
+  return internal_JSON_MoveValue(node, key, value_node);
 }
 
 call_result_t script::JSON_SetArray(node_ptr_t node, const std::string key, const node_ptr_t value_node) {
-  ASSERT_NODE_EXISTS(value_node);
-  auto result = internal_JSON_SetValue(node, key, *value_node);
-  if (result == JSON_CALL_NO_ERR) {
-    JSON_Cleanup(value_node);
-  }
-  return result;
+  return internal_JSON_MoveValue(node, key, value_node);
 }
 
 call_result_t script::JSON_GetBool(node_ptr_t node, const std::string key, bool *out) {
-  ASSERT_NODE_EXISTS(node);
-  if (!node->contains(key)) {
+  ASSERT_NODE_EXISTS_SHALLOW(node);
+  auto member = internal_JSON_FindMember(node, key);
+  if (member == nullptr) {
     PLUGIN_LOG("Node not exists");
     return JSON_CALL_NODE_NOT_EXISTS_ERR;
   }
-  auto &subnode = (*node)[key];
+  auto &subnode = *member;
   if (!subnode.is_boolean()) {
     PLUGIN_LOG("Array item '%s' type does not equal to required one", key.c_str());
     return JSON_CALL_WRONG_TYPE_ERR;
@@ -268,12 +914,13 @@ call_result_t script::JSON_GetBool(node_ptr_t node, const std::string key, bool
 }
 
 call_result_t script::JSON_GetInt(node_ptr_t node, const std::string key, cell *out) {
-  ASSERT_NODE_EXISTS(node);
-  if (!node->contains(key)) {
+  ASSERT_NODE_EXISTS_SHALLOW(node);
+  auto member = internal_JSON_FindMember(node, key);
+  if (member == nullptr) {
     PLUGIN_LOG("Node does not have item by key '%s'", key.c_str());
     return JSON_CALL_NODE_NOT_EXISTS_ERR;
   }
-  auto &subnode = (*node)[key];
+  auto &subnode = *member;
   if (!subnode.is_number_integer()) {
     PLUGIN_LOG("Array item '%s' type does not equal to required one", key.c_str());
     return JSON_CALL_WRONG_TYPE_ERR;
@@ -283,12 +930,13 @@ call_result_t script::JSON_GetInt(node_ptr_t node, const std::string key, cell *
 }
 
 call_result_t script::JSON_GetFloat(node_ptr_t node, const std::string key, float *out) {
-  ASSERT_NODE_EXISTS(node);
-  if (!node->contains(key)) {
+  ASSERT_NODE_EXISTS_SHALLOW(node);
+  auto member = internal_JSON_FindMember(node, key);
+  if (member == nullptr) {
     PLUGIN_LOG("Node does not have item by key '%s'", key.c_str());
     return JSON_CALL_NODE_NOT_EXISTS_ERR;
   }
-  auto &subnode = (*node)[key];
+  auto &subnode = *member;
   if (!subnode.is_number_float()) {
     PLUGIN_LOG("Array item '%s' type does not equal to required one", key.c_str());
     return JSON_CALL_WRONG_TYPE_ERR;
@@ -298,12 +946,13 @@ call_result_t script::JSON_GetFloat(node_ptr_t node, const std::string key, floa
 }
 
 call_result_t script::JSON_GetString(node_ptr_t node, const std::string key, cell *out, cell out_size) {
-  ASSERT_NODE_EXISTS(node);
-  if (!node->contains(key)) {
+  ASSERT_NODE_EXISTS_SHALLOW(node);
+  auto member = internal_JSON_FindMember(node, key);
+  if (member == nullptr) {
     PLUGIN_LOG("Node does not have item by key '%s'", key.c_str());
     return JSON_CALL_NODE_NOT_EXISTS_ERR;
   }
-  auto &subnode = (*node)[key];
+  auto &subnode = *member;
   if (!subnode.is_string()) {
     PLUGIN_LOG("Array item '%s' type does not equal to required one", key.c_str());
     return JSON_CALL_WRONG_TYPE_ERR;
@@ -315,8 +964,9 @@ call_result_t script::JSON_GetString(node_ptr_t node, const std::string key, cel
 }
 
 call_result_t script::JSON_GetObject(node_ptr_t node, const std::string key, node_ptr_t *out) {
-  ASSERT_NODE_EXISTS(node);
-  if (!node->contains(key)) {
+  ASSERT_NODE_EXISTS_SHALLOW(node);
+  auto member = internal_JSON_FindMember(node, key);
+  if (member == nullptr) {
     PLUGIN_LOG("Node does not have item by key '%s'", key.c_str());
     return JSON_CALL_NODE_NOT_EXISTS_ERR;
   }
@@ -326,35 +976,347 @@ call_result_t script::JSON_GetObject(node_ptr_t node, const std::string key, nod
 //    return JSON_CALL_WRONG_TYPE_ERR;
 //  }
   JSON_Cleanup(*out);
-  *out = reinterpret_cast<node_ptr_t>(new nlohmann::ordered_json((*node)[key]));
-  valid_nodes.insert(*out);
+  *out = reinterpret_cast<node_ptr_t>(new nlohmann::ordered_json(*member));
+  if (!internal_JSON_Track(*out))
+    return JSON_CALL_MEMORY_QUOTA_ERR;
   return JSON_CALL_NO_ERR;
 }
 
 call_result_t script::JSON_GetArray(node_ptr_t node, const std::string key, node_ptr_t *out) {
-  ASSERT_NODE_EXISTS(node);
-  if (!node->contains(key)) {
+  ASSERT_NODE_EXISTS_SHALLOW(node);
+  auto member = internal_JSON_FindMember(node, key);
+  if (member == nullptr) {
     PLUGIN_LOG("Node does not have item by key '%s'", key.c_str());
     return JSON_CALL_NODE_NOT_EXISTS_ERR;
   }
-  auto &subnode = (*node)[key];
+  auto &subnode = *member;
   if (!subnode.is_array()) {
     PLUGIN_LOG("Array item '%s' type does not equal to required one", key.c_str());
     return JSON_CALL_WRONG_TYPE_ERR;
   }
   JSON_Cleanup(*out);
   *out = reinterpret_cast<node_ptr_t>(new nlohmann::ordered_json(subnode));
-  valid_nodes.insert(*out);
+  if (!internal_JSON_Track(*out))
+    return JSON_CALL_MEMORY_QUOTA_ERR;
   return JSON_CALL_NO_ERR;
 }
 
-node_type_t script::JSON_GetType(node_ptr_t node, const std::string key) {
+// lookup for JSON_TryGet* natives: no logging, nullptr if node not exists or member has other type
+inline const nlohmann::ordered_json *internal_JSON_TryFind(const node_ptr_t node, const std::string &key,
+    bool (nlohmann::ordered_json::*is_type)() const noexcept) {
+  if (node == nullptr || valid_nodes.find(node) == valid_nodes.cend())
+    return nullptr;
+  auto member = internal_JSON_FindMember(node, key);
+  return member != nullptr && (member->*is_type)() ? member : nullptr;
+}
+
+cell script::JSON_TryGetBool(node_ptr_t node, const std::string key, const bool fallback) {
+  auto member = internal_JSON_TryFind(node, key, &nlohmann::ordered_json::is_boolean);
+  return member != nullptr ? member->get<bool>() : fallback;
+}
+
+cell script::JSON_TryGetInt(node_ptr_t node, const std::string key, const cell fallback) {
+  auto member = internal_JSON_TryFind(node, key, &nlohmann::ordered_json::is_number_integer);
+  return member != nullptr ? member->get<cell>() : fallback;
+}
+
+cell script::JSON_TryGetFloat(node_ptr_t node, const std::string key, const float fallback) {
+  auto member = internal_JSON_TryFind(node, key, &nlohmann::ordered_json::is_number_float);
+  auto value = member != nullptr ? member->get<float>() : fallback;
+  return *reinterpret_cast<const cell *>(&value);
+}
+
+cell script::JSON_TryGetString(node_ptr_t node, const std::string key, cell *out, const cell out_size, const std::string fallback) {
+  auto member = internal_JSON_TryFind(node, key, &nlohmann::ordered_json::is_string);
+  if (member == nullptr) {
+    SetString(out, fallback, out_size);
+    return false;
+  }
+  SetString(out, iconvlite::utf2cp(member->get_ref<const std::string &>()), out_size);
+  return true;
+}
+
+call_result_t script::JSON_GetMany(const cell *params) {
+  field_errors.clear();
+  if (params[0] / sizeof(cell) < 2) {
+    PLUGIN_LOG("Node and format must be passed");
+    return JSON_CALL_FORMAT_ERR;
+  }
+  auto node = reinterpret_cast<node_ptr_t>(params[1]);
   ASSERT_NODE_EXISTS(node);
-  if (!node->contains(key)) {
+  if (!node->is_object()) {
+    PLUGIN_LOG("Node type does not equal to required one");
+    return JSON_CALL_WRONG_TYPE_ERR;
+  }
+  auto spec = json_fields::get(GetString(params[2]));
+  if (spec == nullptr || params[0] / sizeof(cell) - 2 != spec->arguments) {
+    PLUGIN_LOG("Invalid format or count of arguments passed");
+    return JSON_CALL_FORMAT_ERR;
+  }
+  call_result_t result = JSON_CALL_NO_ERR;
+  auto arg = params + 3;
+  for (const auto &field : spec->fields) {
+    if (field.type == json_fields::field_type::padding)
+      continue;
+    auto error = field_errors.emplace_back(internal_JSON_GetField(*node, field, GetPhysAddr(*arg++)));
+    if (result == JSON_CALL_NO_ERR)
+      result = error;
+  }
+  return result;
+}
+
+call_result_t script::JSON_SetMany(const cell *params) {
+  field_errors.clear();
+  if (params[0] / sizeof(cell) < 2) {
+    PLUGIN_LOG("Node and format must be passed");
+    return JSON_CALL_FORMAT_ERR;
+  }
+  auto node = reinterpret_cast<node_ptr_t>(params[1]);
+  ASSERT_NODE_EXISTS(node);
+  if (!node->is_object() && !node->is_null()) {
+    PLUGIN_LOG("Node type does not equal to required one");
+    return JSON_CALL_WRONG_TYPE_ERR;
+  }
+  auto spec = json_fields::get(GetString(params[2]));
+  if (spec == nullptr || params[0] / sizeof(cell) - 2 != spec->arguments) {
+    PLUGIN_LOG("Invalid format or count of arguments passed");
+    return JSON_CALL_FORMAT_ERR;
+  }
+  ASSERT_CAN_GROW(node, internal_JSON_SetManyBytes(node, *spec, params + 3));
+  auto fields_bytes = [&] {
+    auto bytes = json_memory_stats::container_size(*node);
+    for (const auto &field : spec->fields) {
+      if (field.type != json_fields::field_type::padding)
+        bytes += json_memory_stats::member_size(*node, field.key);
+    }
+    return bytes;
+  };
+  tree_resize resize(node, fields_bytes, node);
+  call_result_t result = JSON_CALL_NO_ERR;
+  auto arg = params + 3;
+  for (const auto &field : spec->fields) {
+    if (field.type == json_fields::field_type::padding)
+      continue;
+    auto error = field_errors.emplace_back(internal_JSON_SetField(*node, field, GetPhysAddr(*arg++)));
+    if (result == JSON_CALL_NO_ERR)
+      result = error;
+  }
+  resize.done(fields_bytes);
+  internal_JSON_Touch(node);
+  return result;
+}
+
+cell script::JSON_GetFieldErrors(cell *out, const cell out_size) {
+  // negative size would turn into a huge size_t
+  auto count = std::min<size_t>(field_errors.size(), std::max<cell>(out_size, 0));
+  std::copy_n(field_errors.cbegin(), count, out);
+  return static_cast<cell>(field_errors.size());
+}
+
+call_result_t script::internal_JSON_GetField(const nlohmann::ordered_json &parent, const json_fields::field &field, cell *out) {
+  using field_type = json_fields::field_type;
+  auto item = parent.find(field.key);
+  if (item == parent.cend())
+    return JSON_CALL_NODE_NOT_EXISTS_ERR;
+  switch (field.type) {
+  case field_type::integer:
+    if (!item->is_number_integer())
+      return JSON_CALL_WRONG_TYPE_ERR;
+    *out = item->get<cell>();
+    break;
+  case field_type::floating:
+    if (!item->is_number_float())
+      return JSON_CALL_WRONG_TYPE_ERR;
+    *reinterpret_cast<float *>(out) = item->get<float>();
+    break;
+  case field_type::boolean:
+    if (!item->is_boolean())
+      return JSON_CALL_WRONG_TYPE_ERR;
+    *out = item->get<bool>();
+    break;
+  case field_type::string:
+    if (!item->is_string())
+      return JSON_CALL_WRONG_TYPE_ERR;
+    SetString(out, iconvlite::utf2cp(item->get_ref<const std::string &>()), field.length);
+    break;
+  case field_type::node: {
+    auto target = reinterpret_cast<node_ptr_t *>(out);
+    JSON_Cleanup(*target);
+    *target = new nlohmann::ordered_json(*item);
+    if (!internal_JSON_Track(*target))
+      return JSON_CALL_MEMORY_QUOTA_ERR;
+    break;
+  }
+  default:break;
+  }
+  return JSON_CALL_NO_ERR;
+}
+
+// upper bound of bytes JSON_SetMany adds to the tree, checked against quota before any field is set
+size_t script::internal_JSON_SetManyBytes(const node_ptr_t node, const json_fields &spec, const cell *args) {
+  using field_type = json_fields::field_type;
+  size_t bytes = 0;
+  size_t count = 0;
+  for (const auto &field : spec.fields) {
+    if (field.type == field_type::padding)
+      continue;
+    ++count;
+    bytes += json_memory_stats::key_heap_size(field.key);
+    auto value = GetPhysAddr(*args++);
+    if (field.type == field_type::string) {
+      // a character of script's codepage takes up to 3 bytes in UTF-8
+      bytes += field.length * 3 + 1;
+    } else if (field.type == field_type::node) {
+      auto item = *reinterpret_cast<const node_ptr_t *>(value);
+      if (internal_JSON_NodeExists(reinterpret_cast<cell>(item)))
+        bytes += internal_JSON_IncomingBytes(node, item);
+    }
+  }
+  return bytes + json_memory_stats::insert_growth(*node, count);
+}
+
+call_result_t script::internal_JSON_SetField(nlohmann::ordered_json &parent, const json_fields::field &field, const cell *value) {
+  using field_type = json_fields::field_type;
+  switch (field.type) {
+  case field_type::integer:parent[field.key] = *value;
+    break;
+  case field_type::floating:parent[field.key] = *reinterpret_cast<const float *>(value);
+    break;
+  case field_type::boolean:parent[field.key] = *value != 0;
+    break;
+  case field_type::string:parent[field.key] = iconvlite::cp2utf(internal_JSON_ReadString(value, field.length));
+    break;
+  case field_type::node: {
+    auto item = *reinterpret_cast<const node_ptr_t *>(value);
+    if (!internal_JSON_NodeExists(reinterpret_cast<cell>(item)))
+      return JSON_CALL_NODE_NOT_EXISTS_ERR;
+    if (item == &parent || item == internal_JSON_Owner(&parent))
+      return JSON_CALL_UNKNOWN_ERR;
+    parent[field.key] = internal_JSON_Consume(item);
+    break;
+  }
+  default:break;
+  }
+  return JSON_CALL_NO_ERR;
+}
+
+node_ptr_result_t script::JSON_DefineLayout(const std::string spec) {
+  auto layout = json_fields::get(spec);
+  if (layout == nullptr) {
+    PLUGIN_LOG("Invalid layout spec passed");
+    return JSON_INVALID_NODE;
+  }
+  for (const auto &field : layout->fields) {
+    if (field.type == json_fields::field_type::node) {
+      PLUGIN_LOG("Layout can not contain JsonNode field '%s'", field.key.c_str());
+      return JSON_INVALID_NODE;
+    }
+  }
+  valid_layouts.insert(layout);
+  return reinterpret_cast<node_ptr_result_t>(layout);
+}
+
+call_result_t script::JSON_FromLayout(const layout_ptr_t layout, const cell *data, node_ptr_t *node, const cell data_size) {
+  if (node == nullptr)
+    return JSON_CALL_NODE_NOT_EXISTS_ERR;
+  if (valid_layouts.find(layout) == valid_layouts.cend() || layout->cells > static_cast<size_t>(data_size)) {
+    PLUGIN_LOG("Layout not exists or does not fit into array");
+    return JSON_CALL_FORMAT_ERR;
+  }
+  auto obj = new nlohmann::ordered_json(nlohmann::ordered_json::object());
+  for (const auto &field : layout->fields) {
+    if (field.type != json_fields::field_type::padding)
+      internal_JSON_SetField(*obj, field, data + field.offset);
+  }
+  JSON_Cleanup(*node);
+  *node = obj;
+  if (!internal_JSON_Track(*node))
+    return JSON_CALL_MEMORY_QUOTA_ERR;
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t script::JSON_ToLayout(const node_ptr_t node, const layout_ptr_t layout, cell *data, const cell data_size) {
+  field_errors.clear();
+  ASSERT_NODE_EXISTS(node);
+  if (!node->is_object()) {
+    PLUGIN_LOG("Node type does not equal to required one");
+    return JSON_CALL_WRONG_TYPE_ERR;
+  }
+  if (valid_layouts.find(layout) == valid_layouts.cend() || layout->cells > static_cast<size_t>(data_size)) {
+    PLUGIN_LOG("Layout not exists or does not fit into array");
+    return JSON_CALL_FORMAT_ERR;
+  }
+  call_result_t result = JSON_CALL_NO_ERR;
+  for (const auto &field : layout->fields) {
+    if (field.type == json_fields::field_type::padding)
+      continue;
+    auto error = field_errors.emplace_back(internal_JSON_GetField(*node, field, data + field.offset));
+    if (result == JSON_CALL_NO_ERR)
+      result = error;
+  }
+  return result;
+}
+
+node_ptr_result_t script::JSON_CompileSchema(const node_ptr_t schema) {
+  if (schema == nullptr || valid_nodes.find(schema) == valid_nodes.cend())
+    return JSON_INVALID_NODE;
+  internal_JSON_Materialize(schema);
+  std::string error;
+  auto validator = json_schema::compile(*schema, error);
+  if (!validator) {
+    PLUGIN_LOG("Invalid schema: %s", error.c_str());
+    return JSON_INVALID_NODE;
+  }
+  auto ptr = validator.get();
+  valid_validators.emplace(ptr, std::move(validator));
+  return reinterpret_cast<node_ptr_result_t>(ptr);
+}
+
+call_result_t script::JSON_Validate(const validator_ptr_t validator, const node_ptr_t node, cell *out, const cell out_size) {
+  ASSERT_NODE_EXISTS(node);
+  if (valid_validators.find(validator) == valid_validators.cend())
+    return JSON_CALL_NO_SUCH_VALIDATOR_ERR;
+  std::string error;
+  if (validator->validate(*node, error)) {
+    SetString(out, "", out_size);
+    return JSON_CALL_NO_ERR;
+  }
+  SetString(out, iconvlite::utf2cp(error), out_size);
+  return JSON_CALL_VALIDATION_ERR;
+}
+
+call_result_t script::JSON_DestroyValidator(const validator_ptr_t validator) {
+  if (valid_validators.erase(validator) == 0)
+    return JSON_CALL_NO_SUCH_VALIDATOR_ERR;
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t script::JSON_Query(const node_ptr_t node, const std::string query, node_ptr_t *result) {
+  ASSERT_NODE_EXISTS(node);
+  if (result == nullptr)
+    return JSON_CALL_NODE_NOT_EXISTS_ERR;
+  std::string error;
+  auto compiled = json_query::get(iconvlite::cp2utf(query), error);
+  if (compiled == nullptr) {
+    PLUGIN_LOG("Invalid query '%s': %s", query.c_str(), error.c_str());
+    return JSON_CALL_FORMAT_ERR;
+  }
+  auto value = new nlohmann::ordered_json(compiled->evaluate(*node));
+  JSON_Cleanup(*result);
+  *result = value;
+  if (!internal_JSON_Track(*result))
+    return JSON_CALL_MEMORY_QUOTA_ERR;
+  return JSON_CALL_NO_ERR;
+}
+
+node_type_t script::JSON_GetType(node_ptr_t node, const std::string key) {
+  ASSERT_NODE_EXISTS_SHALLOW(node);
+  auto member = internal_JSON_FindMember(node, key);
+  if (member == nullptr) {
     PLUGIN_LOG("Node does not have item by key '%s'", key.c_str());
     return JSON_CALL_NODE_NOT_EXISTS_ERR;
   }
-  return internal_JSON_NodeType(reinterpret_cast<node_ptr_t>(&((*node)[key])));
+  return internal_JSON_NodeType(member);
 }
 
 call_result_t script::JSON_ArrayLength(node_ptr_t node, cell *out) {
@@ -384,7 +1346,8 @@ call_result_t script::JSON_ArrayObject(node_ptr_t node, cell index, node_ptr_t *
   }
   JSON_Cleanup(*out);
   *out = reinterpret_cast<node_ptr_t>(new nlohmann::ordered_json((*node)[index]));
-  valid_nodes.insert(*out);
+  if (!internal_JSON_Track(*out))
+    return JSON_CALL_MEMORY_QUOTA_ERR;
   return JSON_CALL_NO_ERR;
 }
 
@@ -400,7 +1363,8 @@ call_result_t script::JSON_ArrayIterate(node_ptr_t node, cell *index, node_ptr_t
   }
   JSON_Cleanup(*out);
   *out = new nlohmann::ordered_json((*node)[next_index]);
-  valid_nodes.insert(*out);
+  if (!internal_JSON_Track(*out))
+    return JSON_CALL_MEMORY_QUOTA_ERR;
   *index = next_index;
   return JSON_CALL_NO_ERR;
 }
@@ -408,29 +1372,40 @@ call_result_t script::JSON_ArrayIterate(node_ptr_t node, cell *index, node_ptr_t
 call_result_t script::JSON_ArrayAppend(node_ptr_t node, const std::string key, node_ptr_t value_node) {
   ASSERT_NODE_EXISTS(node);
   ASSERT_NODE_EXISTS(value_node);
+  ASSERT_NODES_DIFFER(node, value_node);
   if (!node->is_object()) {
     PLUGIN_LOG("Node type does not equal to required one");
     return JSON_CALL_WRONG_TYPE_ERR;
   }
-  auto &subnode = (*node)[key];
-  if (!subnode.is_array()) {
+  auto member = internal_JSON_FindMember(node, key);
+  if (member == nullptr || !member->is_array()) {
     PLUGIN_LOG("Subnode type does not equal to required one");
     return JSON_CALL_WRONG_TYPE_ERR;
   }
-  subnode.emplace_back(*value_node);
-  JSON_Cleanup(value_node);
+  auto &subnode = *member;
+  ASSERT_CAN_GROW(node, internal_JSON_IncomingBytes(node, value_node) + json_memory_stats::insert_growth(subnode));
+  tree_resize resize(node, [&] { return json_memory_stats::container_size(subnode); });
+  subnode.emplace_back(internal_JSON_Consume(value_node));
+  resize.done([&] { return json_memory_stats::container_size(subnode) + json_memory_stats::heap_size(subnode.back()); });
+  internal_JSON_UpdateIndexes(node, key, [](json_index &index) { index.appended(); });
+  internal_JSON_Touch(node, true);
   return JSON_CALL_NO_ERR;
 }
 
 call_result_t script::JSON_ArrayAppendEx(node_ptr_t node, node_ptr_t value_node) {
   ASSERT_NODE_EXISTS(node);
   ASSERT_NODE_EXISTS(value_node);
+  ASSERT_NODES_DIFFER(node, value_node);
   if (!node->is_array()) {
     PLUGIN_LOG("Node type does not equal to required one");
     return JSON_CALL_WRONG_TYPE_ERR;
   }
-  node->emplace_back(*value_node);
-  JSON_Cleanup(value_node);
+  ASSERT_CAN_GROW(node, internal_JSON_IncomingBytes(node, value_node) + json_memory_stats::insert_growth(*node));
+  tree_resize resize(node, [&] { return json_memory_stats::container_size(*node); });
+  node->emplace_back(internal_JSON_Consume(value_node));
+  resize.done([&] { return json_memory_stats::container_size(*node) + json_memory_stats::heap_size(node->back()); });
+  internal_JSON_UpdateIndexes(node, "", [](json_index &index) { index.appended(); });
+  internal_JSON_Touch(node, true);
   return JSON_CALL_NO_ERR;
 }
 
@@ -441,18 +1416,36 @@ call_result_t script::JSON_ArrayRemove(node_ptr_t node, const std::string key, n
     PLUGIN_LOG("Node type does not equal to required one");
     return JSON_CALL_WRONG_TYPE_ERR;
   }
-  auto &subnode = (*node)[key];
-  if (!subnode.is_array()) {
+  auto member = internal_JSON_FindMember(node, key);
+  if (member == nullptr || !member->is_array()) {
     PLUGIN_LOG("Subnode type does not equal to required one");
     return JSON_CALL_WRONG_TYPE_ERR;
   }
+  auto &subnode = *member;
+  // value borrowed from the same tree may be one of the elements (or contain the array), which
+  // erasing shifts or changes, so it is compared by copy
+  std::optional<nlohmann::ordered_json> value_copy;
+  if (internal_JSON_Owner(value_node) == internal_JSON_Owner(node))
+    value_copy.emplace(*value_node);
+  const auto &value = value_copy ? *value_copy : *value_node;
+  auto array_bytes = [&] { return json_memory_stats::container_size(subnode); };
+  tree_resize resize(node, array_bytes);
+  bool removed = false;
+  size_t removed_bytes = 0;
   for (auto ptr = subnode.cbegin(); ptr != subnode.end();) {
-    if (*ptr == *value_node) {
+    if (internal_JSON_MayEqual(*ptr, value) && *ptr == value) {
+      removed_bytes += json_memory_stats::heap_size(*ptr);
       ptr = subnode.erase(ptr);
+      removed = true;
     } else {
       ++ptr;
     }
   }
+  // unchanged array keeps revision, and with it cached hashes and skip_unchanged saves
+  if (removed) {
+    resize.done(array_bytes, removed_bytes);
+    internal_JSON_Touch(node);
+  }
   return JSON_CALL_NO_ERR;
 }
 
@@ -463,20 +1456,27 @@ call_result_t script::JSON_ArrayRemoveIndex(node_ptr_t node, const std::string k
       PLUGIN_LOG("Node type does not equal to required one");
       return JSON_CALL_WRONG_TYPE_ERR;
     }
-    if (!node->contains(key)) {
+    auto member = internal_JSON_FindMember(node, key);
+    if (member == nullptr) {
       PLUGIN_LOG("Node does not have item by key '%s'", key.c_str());
       return JSON_CALL_NODE_NOT_EXISTS_ERR;
     }
-    auto &subnode = (*node)[key];
+    auto &subnode = *member;
     if (!subnode.is_array()) {
       PLUGIN_LOG("Subnode type does not equal to required one");
       return JSON_CALL_WRONG_TYPE_ERR;
     }
-    if (subnode.size() < index) {
+    if (index < 0 || static_cast<size_t>(index) >= subnode.size()) {
       PLUGIN_LOG("Node does not have item by index %d", index);
       return JSON_CALL_NODE_NOT_EXISTS_ERR;
     }
-    subnode.erase(index);
+    internal_JSON_UpdateIndexes(node, key, [&](json_index &item) { item.removing(index); });
+    auto array_bytes = [&] { return json_memory_stats::container_size(subnode); };
+    tree_resize resize(node, array_bytes);
+    auto removed_bytes = json_memory_stats::heap_size(subnode[static_cast<size_t>(index)]);
+    subnode.erase(static_cast<size_t>(index));
+    resize.done(array_bytes, removed_bytes);
+    internal_JSON_Touch(node, true);
     return JSON_CALL_NO_ERR;
   }
   catch (const std::exception &e) {
@@ -490,27 +1490,339 @@ call_result_t script::JSON_ArrayClear(node_ptr_t node, const std::string key) {
     PLUGIN_LOG("Node type does not equal to required one");
     return JSON_CALL_WRONG_TYPE_ERR;
   }
-  if (!node->contains(key)) {
+  auto member = internal_JSON_FindMember(node, key);
+  if (member == nullptr) {
     PLUGIN_LOG("Node does not have item by key '%s'", key.c_str());
     return JSON_CALL_NODE_NOT_EXISTS_ERR;
   }
-  auto &subnode = (*node)[key];
+  auto &subnode = *member;
 //  TODO: Original plugin has check to node[key] type, should it be there?
 //  if (!subnode.is_array()) {
 //    PLUGIN_LOG("Subnode type does not equal to required one");
 //    return JSON_CALL_WRONG_TYPE_ERR;
 //  }
+  auto member_bytes = [&] { return json_memory_stats::heap_size(subnode); };
+  tree_resize resize(node, member_bytes);
   subnode.clear();
+  resize.done(member_bytes);
+  internal_JSON_UpdateIndexes(node, key, [](json_index &index) { index.cleared(); });
+  internal_JSON_Touch(node, true);
   return JSON_CALL_NO_ERR;
 }
 
 call_result_t script::JSON_Remove(node_ptr_t node, const std::string key) {
-  ASSERT_NODE_EXISTS(node);
+  ASSERT_NODE_EXISTS_SHALLOW(node);
   if (!node->is_object()) {
     PLUGIN_LOG("Node type does not equal to required one");
     return JSON_CALL_WRONG_TYPE_ERR;
   }
-  node->erase(key);
+  internal_JSON_MaterializeMember(node, key, true);
+  auto member_bytes = [&] { return internal_JSON_MemberBytes(*node, key); };
+  tree_resize resize(node, member_bytes);
+  // removing a missing key changes nothing, so revision, indexes and borrowed handles are kept
+  if (node->erase(key) != 0) {
+    resize.done(member_bytes);
+    internal_JSON_Touch(node);
+  }
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t script::JSON_ArraySort(node_ptr_t node, const std::string key_path, const cell order) {
+  ASSERT_NODE_EXISTS(node);
+  if (!node->is_array() || order < JSON_SORT_ASC || order >= JSON_SORT_MAX) {
+    PLUGIN_LOG("Node type does not equal to required one");
+    return JSON_CALL_WRONG_TYPE_ERR;
+  }
+  auto keys = internal_JSON_SplitKeyPath(iconvlite::cp2utf(key_path));
+  auto &items = node->get_ref<nlohmann::ordered_json::array_t &>();
+  auto less = [&](const nlohmann::ordered_json &a, const nlohmann::ordered_json &b) {
+    return internal_JSON_SortLess(internal_JSON_ResolveKeyPath(a, keys), internal_JSON_ResolveKeyPath(b, keys));
+  };
+  if (order == JSON_SORT_ASC)
+    std::stable_sort(items.begin(), items.end(), less);
+  else
+    std::stable_sort(items.begin(), items.end(), [&](const auto &a, const auto &b) { return less(b, a); });
+  internal_JSON_Touch(node);
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t script::JSON_ArrayFind(const node_ptr_t node, const std::string key_path, const node_ptr_t value, cell *index, const cell start) {
+  ASSERT_NODE_EXISTS(node);
+  ASSERT_NODE_EXISTS(value);
+  *index = -1;
+  if (!node->is_array()) {
+    PLUGIN_LOG("Node type does not equal to required one");
+    return JSON_CALL_WRONG_TYPE_ERR;
+  }
+  auto keys = internal_JSON_SplitKeyPath(iconvlite::cp2utf(key_path));
+  for (size_t i = std::max<cell>(start, 0); i < node->size(); ++i) {
+    if (internal_JSON_ResolveKeyPath((*node)[i], keys) == *value) {
+      *index = static_cast<cell>(i);
+      return JSON_CALL_NO_ERR;
+    }
+  }
+  return JSON_CALL_NODE_NOT_EXISTS_ERR;
+}
+
+call_result_t script::JSON_ArrayBinarySearch(const node_ptr_t node, const std::string key_path, const node_ptr_t value, cell *index, const cell order) {
+  ASSERT_NODE_EXISTS(node);
+  ASSERT_NODE_EXISTS(value);
+  *index = -1;
+  if (!node->is_array() || order < JSON_SORT_ASC || order >= JSON_SORT_MAX) {
+    PLUGIN_LOG("Node type does not equal to required one");
+    return JSON_CALL_WRONG_TYPE_ERR;
+  }
+  auto keys = internal_JSON_SplitKeyPath(iconvlite::cp2utf(key_path));
+  const auto &items = node->get_ref<const nlohmann::ordered_json::array_t &>();
+  auto item = std::lower_bound(items.begin(), items.end(), *value, [&](const nlohmann::ordered_json &item, const nlohmann::ordered_json &target) {
+    const auto &current = internal_JSON_ResolveKeyPath(item, keys);
+    return order == JSON_SORT_ASC ? internal_JSON_SortLess(current, target) : internal_JSON_SortLess(target, current);
+  });
+  *index = static_cast<cell>(item - items.begin());
+  if (item == items.end() || internal_JSON_ResolveKeyPath(*item, keys) != *value)
+    return JSON_CALL_NODE_NOT_EXISTS_ERR;
+  return JSON_CALL_NO_ERR;
+}
+
+node_ptr_result_t script::JSON_CreateIndex(const node_ptr_t node, const std::string key_pointer, const std::string array_key) {
+  if (node == nullptr || valid_nodes.find(node) == valid_nodes.cend())
+    return JSON_INVALID_NODE;
+  auto &info = valid_nodes.find(node)->second;
+  if (info.owner != nullptr) {
+    PLUGIN_LOG("Index cannot be created over borrowed node");
+    return JSON_INVALID_NODE;
+  }
+  internal_JSON_Materialize(node);
+  try {
+    auto index = std::make_unique<json_index>(node, array_key, nlohmann::ordered_json::json_pointer(key_pointer));
+    if (index->array() == nullptr) {
+      PLUGIN_LOG("Node type does not equal to required one");
+      return JSON_INVALID_NODE;
+    }
+    auto ptr = index.get();
+    valid_indexes.emplace(ptr, std::move(index));
+    info.indexes.push_back(ptr);
+    return reinterpret_cast<node_ptr_result_t>(ptr);
+  } catch (const std::exception &e) {
+    LOG_EXCEPTION(e);
+    return JSON_INVALID_NODE;
+  }
+}
+
+call_result_t script::internal_JSON_IndexLookup(const index_ptr_t index, const nlohmann::ordered_json &value, node_ptr_t *element, cell *position) {
+  if (valid_indexes.find(index) == valid_indexes.cend())
+    return JSON_CALL_NO_SUCH_INDEX_ERR;
+  auto found = index->find(value);
+  if (!found)
+    return JSON_CALL_NODE_NOT_EXISTS_ERR;
+  auto owner = index->indexed_node();
+  auto item = &(*index->array())[*found];
+  // script's variable may hold the indexed node itself, which must outlive the index
+  if (*element != owner)
+    JSON_Cleanup(*element);
+  *element = item;
+  auto [entry, inserted] = valid_nodes.try_emplace(item);
+  if (inserted) {
+    entry->second.owner = owner;
+    valid_nodes.find(owner)->second.borrowed.push_back(item);
+  }
+  *position = static_cast<cell>(*found);
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t script::JSON_IndexLookup(const index_ptr_t index, const node_ptr_t value, node_ptr_t *element, cell *position) {
+  ASSERT_NODE_EXISTS(value);
+  return internal_JSON_IndexLookup(index, *value, element, position);
+}
+
+call_result_t script::JSON_IndexLookupInt(const index_ptr_t index, const cell value, node_ptr_t *element, cell *position) {
+  return internal_JSON_IndexLookup(index, value, element, position);
+}
+
+call_result_t script::JSON_IndexLookupString(const index_ptr_t index, const std::string value, node_ptr_t *element, cell *position) {
+  return internal_JSON_IndexLookup(index, iconvlite::cp2utf(value), element, position);
+}
+
+call_result_t script::JSON_DestroyIndex(const index_ptr_t index) {
+  auto item = valid_indexes.find(index);
+  if (item == valid_indexes.cend())
+    return JSON_CALL_NO_SUCH_INDEX_ERR;
+  auto &indexes = valid_nodes.find(index->indexed_node())->second.indexes;
+  indexes.erase(std::find(indexes.begin(), indexes.end(), index));
+  valid_indexes.erase(item);
+  return JSON_CALL_NO_ERR;
+}
+
+node_ptr_result_t script::JSON_SnapshotCreate(const node_ptr_t node) {
+  if (node == nullptr || valid_nodes.find(node) == valid_nodes.cend())
+    return JSON_INVALID_NODE;
+  internal_JSON_Materialize(node);
+  auto snapshot = std::make_unique<json_persistent>(*node);
+  auto ptr = snapshot.get();
+  valid_snapshots.emplace(ptr, std::move(snapshot));
+  return reinterpret_cast<node_ptr_result_t>(ptr);
+}
+
+node_ptr_result_t script::JSON_SnapshotClone(const snapshot_ptr_t snapshot) {
+  if (valid_snapshots.find(snapshot) == valid_snapshots.cend())
+    return JSON_INVALID_NODE;
+  auto clone = std::make_unique<json_persistent>(*snapshot);
+  auto ptr = clone.get();
+  valid_snapshots.emplace(ptr, std::move(clone));
+  return reinterpret_cast<node_ptr_result_t>(ptr);
+}
+
+call_result_t script::JSON_SnapshotGet(const snapshot_ptr_t snapshot, const std::string key_path, node_ptr_t *node) {
+  if (valid_snapshots.find(snapshot) == valid_snapshots.cend())
+    return JSON_CALL_NO_SUCH_SNAPSHOT_ERR;
+  if (node == nullptr)
+    return JSON_CALL_NODE_NOT_EXISTS_ERR;
+  auto value = snapshot->get(internal_JSON_SplitKeyPath(iconvlite::cp2utf(key_path)));
+  if (!value)
+    return JSON_CALL_NODE_NOT_EXISTS_ERR;
+  JSON_Cleanup(*node);
+  *node = new nlohmann::ordered_json(std::move(*value));
+  if (!internal_JSON_Track(*node))
+    return JSON_CALL_MEMORY_QUOTA_ERR;
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t script::JSON_SnapshotSet(const snapshot_ptr_t snapshot, const std::string key_path, const node_ptr_t value) {
+  if (valid_snapshots.find(snapshot) == valid_snapshots.cend())
+    return JSON_CALL_NO_SUCH_SNAPSHOT_ERR;
+  ASSERT_NODE_EXISTS(value);
+  auto keys = internal_JSON_SplitKeyPath(iconvlite::cp2utf(key_path));
+  // key path is checked before value is consumed, so value stays with the script on error
+  if (!snapshot->settable(keys))
+    return JSON_CALL_NODE_NOT_EXISTS_ERR;
+  snapshot->set(keys, internal_JSON_Consume(value));
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t script::JSON_SnapshotRemove(const snapshot_ptr_t snapshot, const std::string key_path) {
+  if (valid_snapshots.find(snapshot) == valid_snapshots.cend())
+    return JSON_CALL_NO_SUCH_SNAPSHOT_ERR;
+  if (!snapshot->remove(internal_JSON_SplitKeyPath(iconvlite::cp2utf(key_path))))
+    return JSON_CALL_NODE_NOT_EXISTS_ERR;
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t script::JSON_SnapshotDestroy(const snapshot_ptr_t snapshot) {
+  auto item = valid_snapshots.find(snapshot);
+  if (item == valid_snapshots.cend())
+    return JSON_CALL_NO_SUCH_SNAPSHOT_ERR;
+  valid_snapshots.erase(item);
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t script::JSON_SnapshotSave(const std::filesystem::path filename, const snapshot_ptr_t snapshot, const cell indent, const cell compression) {
+  if (valid_snapshots.find(snapshot) == valid_snapshots.cend())
+    return JSON_CALL_NO_SUCH_SNAPSHOT_ERR;
+  if (compression < JSON_COMPRESSION_AUTO || compression >= JSON_COMPRESSION_MAX)
+    return JSON_CALL_INVALID_OPTION_ERR;
+  try {
+    auto dump = [&](const std::shared_ptr<json_file_writer> &writer) { snapshot->dump(writer, indent); };
+    auto result = json_file_writer::save_file(filename, dump, static_cast<JsonCompression>(compression));
+    if (result == JSON_CALL_UNKNOWN_ERR)
+      LOG_AT(JSON_LOG_LEVEL_ERROR, "%s: %d: error: could not write file '%s'", __FUNCTION__, __LINE__, filename.string().c_str());
+    return result;
+  } catch (const std::exception &e) {
+    LOG_EXCEPTION(e);
+    return JSON_CALL_PARSER_ERR;
+  }
+}
+
+call_result_t script::JSON_SnapshotDiff(const snapshot_ptr_t first, const snapshot_ptr_t second, node_ptr_t *patch) {
+  if (valid_snapshots.find(first) == valid_snapshots.cend() || valid_snapshots.find(second) == valid_snapshots.cend())
+    return JSON_CALL_NO_SUCH_SNAPSHOT_ERR;
+  if (patch == nullptr)
+    return JSON_CALL_NODE_NOT_EXISTS_ERR;
+  auto diff = new nlohmann::ordered_json(first->diff(*second));
+  JSON_Cleanup(*patch);
+  *patch = diff;
+  if (!internal_JSON_Track(*patch))
+    return JSON_CALL_MEMORY_QUOTA_ERR;
+  return JSON_CALL_NO_ERR;
+}
+
+node_ptr_result_t script::JSON_CompileTemplate(const std::string text) {
+  std::string error;
+  auto compiled = json_template::compile(text, error);
+  if (!compiled) {
+    PLUGIN_LOG("Invalid template: %s", error.c_str());
+    return JSON_INVALID_NODE;
+  }
+  auto tpl = std::make_unique<json_template>(std::move(*compiled));
+  auto ptr = tpl.get();
+  valid_templates.emplace(ptr, std::move(tpl));
+  return reinterpret_cast<node_ptr_result_t>(ptr);
+}
+
+call_result_t script::JSON_RenderTemplate(const cell *params) {
+  if (params[0] / sizeof(cell) < 3) {
+    PLUGIN_LOG("Template and output must be passed");
+    return JSON_CALL_FORMAT_ERR;
+  }
+  auto tpl = internal_JSON_FindTemplate(params[1]);
+  if (tpl == nullptr)
+    return JSON_CALL_NO_SUCH_TEMPLATE_ERR;
+  if (params[0] / sizeof(cell) - 3 != tpl->placeholders.size()) {
+    PLUGIN_LOG("Invalid count of arguments passed");
+    return JSON_CALL_FORMAT_ERR;
+  }
+  auto out = GetPhysAddr(params[2]);
+  auto out_size = params[3];
+  // output stays in script's codepage, like JSON_Stringify returns it, so string arguments need no conversion;
+  // buffer is reused so that rendering does not allocate once it has grown
+  static std::string output;
+  output.clear();
+  try {
+    auto arg = params + 4;
+    for (const auto &item : tpl->placeholders) {
+      output += item.literal;
+      auto value = GetPhysAddr(*arg);
+      switch (item.type) {
+      case json_template::argument_type::string:
+        if (!item.in_string)
+          output.push_back('"');
+        json_template::append_escaped(output, GetString(*arg));
+        if (!item.in_string)
+          output.push_back('"');
+        break;
+      case json_template::argument_type::integer:json_template::append_integer(output, *value);
+        break;
+      case json_template::argument_type::floating:json_template::append_float(output, *reinterpret_cast<const float *>(value));
+        break;
+      case json_template::argument_type::boolean:output += *value != 0 ? "true" : "false";
+        break;
+      case json_template::argument_type::node: {
+        auto node = reinterpret_cast<node_ptr_t>(*value);
+        ASSERT_NODE_EXISTS(node);
+        output += iconvlite::utf2cp(node->dump());
+        break;
+      }
+      }
+      ++arg;
+    }
+    output += tpl->tail;
+  } catch (const std::exception &e) {
+    LOG_EXCEPTION(e);
+    return JSON_CALL_UNKNOWN_ERR;
+  }
+  if (out_size <= 0 || output.size() >= static_cast<size_t>(out_size)) {
+    if (out_size > 0)
+      SetString(out, "", out_size);
+    return JSON_CALL_NO_RETURN_STRING_ERR;
+  }
+  SetString(out, output, out_size);
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t script::JSON_DestroyTemplate(const template_ptr_t tpl) {
+  auto item = valid_templates.find(tpl);
+  if (item == valid_templates.cend())
+    return JSON_CALL_NO_SUCH_TEMPLATE_ERR;
+  valid_templates.erase(item);
   return JSON_CALL_NO_ERR;
 }
 
@@ -557,6 +1869,28 @@ call_result_t script::JSON_GetNodeString(node_ptr_t node, cell *out, cell out_si
 }
 
 
+call_result_t script::JSON_GetRevision(const node_ptr_t node, cell *out) {
+  ASSERT_NODE_EXISTS(node);
+  *out = static_cast<cell>(valid_nodes.find(node)->second.revision);
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t script::JSON_Hash(const node_ptr_t node, cell *high, cell *low) {
+  ASSERT_NODE_EXISTS(node);
+  auto hash = internal_JSON_Hash(node);
+  *high = static_cast<cell>(static_cast<uint32_t>(hash >> 32));
+  *low = static_cast<cell>(static_cast<uint32_t>(hash));
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t script::JSON_Equal(const node_ptr_t node, const node_ptr_t other, bool *out) {
+  ASSERT_NODE_EXISTS(node);
+  ASSERT_NODE_EXISTS(other);
+  *out = node == other || (internal_JSON_MayEqual(*node, *other)
+      && !internal_JSON_HashesDiffer(node, other) && *node == *other);
+  return JSON_CALL_NO_ERR;
+}
+
 call_result_t script::JSON_StartWatcher(const std::filesystem::path filename) {
   return json_watcher_instance.start(filename);
 }
@@ -565,6 +1899,177 @@ call_result_t script::JSON_StopWatcher(const std::filesystem::path filename) {
   return json_watcher_instance.stop(filename);
 }
 
+node_ptr_result_t script::JSON_LogOpen(const std::filesystem::path filename, const cell flush_interval, const cell sync) {
+  try {
+    if (sync < JSON_LOG_SYNC_NONE || sync >= JSON_LOG_SYNC_MAX)
+      return JSON_INVALID_NODE;
+    auto log = json_log::open(filename, std::chrono::milliseconds(std::max<cell>(flush_interval, 1)), static_cast<JsonLogSync>(sync));
+    if (!log) {
+      LOG_AT(JSON_LOG_LEVEL_ERROR, "%s: %d: error: could not open log '%s'", __FUNCTION__, __LINE__, filename.string().c_str());
+      return JSON_INVALID_NODE;
+    }
+    auto ptr = log.get();
+    valid_logs.emplace(ptr, std::move(log));
+    return reinterpret_cast<node_ptr_result_t>(ptr);
+  } catch (const std::exception &e) {
+    LOG_EXCEPTION(e);
+    return JSON_INVALID_NODE;
+  }
+}
+
+call_result_t script::JSON_LogAppend(const log_ptr_t log, const node_ptr_t node) {
+  ASSERT_NODE_EXISTS(node);
+  if (valid_logs.find(log) == valid_logs.cend())
+    return JSON_CALL_NO_SUCH_LOG_ERR;
+  try {
+    return log->append(*node) ? JSON_CALL_NO_ERR : JSON_CALL_UNKNOWN_ERR;
+  } catch (const std::exception &e) {
+    LOG_EXCEPTION(e);
+    return JSON_CALL_UNKNOWN_ERR;
+  }
+}
+
+call_result_t script::JSON_LogFlush(const log_ptr_t log) {
+  if (valid_logs.find(log) == valid_logs.cend())
+    return JSON_CALL_NO_SUCH_LOG_ERR;
+  return log->flush() ? JSON_CALL_NO_ERR : JSON_CALL_UNKNOWN_ERR;
+}
+
+call_result_t script::JSON_LogClose(const log_ptr_t log) {
+  if (valid_logs.erase(log) == 0)
+    return JSON_CALL_NO_SUCH_LOG_ERR;
+  return JSON_CALL_NO_ERR;
+}
+
+void script::internal_JSON_CloseLogs() {
+  valid_logs.clear();
+}
+
+node_ptr_result_t script::JSON_LinesOpen(const std::filesystem::path filename) {
+  try {
+    auto reader = json_lines::open(filename);
+    if (!reader)
+      return JSON_INVALID_NODE;
+    auto ptr = reader.get();
+    valid_readers.emplace(ptr, std::move(reader));
+    return reinterpret_cast<node_ptr_result_t>(ptr);
+  } catch (const std::exception &e) {
+    LOG_EXCEPTION(e);
+    return JSON_INVALID_NODE;
+  }
+}
+
+call_result_t script::internal_JSON_LinesParse(const lines_ptr_t reader, node_ptr_t *node) {
+  auto record = reader->next();
+  if (!record)
+    return JSON_CALL_NODE_NOT_EXISTS_ERR;
+  try {
+    auto value = nlohmann::ordered_json::parse(record->begin(), record->end());
+    if (*node != nullptr && valid_nodes.find(*node) != valid_nodes.cend()) {
+      lazy_nodes.erase(*node);
+      **node = std::move(value);
+      // whole tree was replaced, it is estimated again on next accounting
+      stale_nodes.insert(internal_JSON_Owner(*node));
+      internal_JSON_Touch(*node);
+    } else {
+      *node = new nlohmann::ordered_json(std::move(value));
+      if (!internal_JSON_Track(*node))
+        return JSON_CALL_MEMORY_QUOTA_ERR;
+    }
+    return JSON_CALL_NO_ERR;
+  } catch (const std::exception &e) {
+    LOG_AT(JSON_LOG_LEVEL_WARNING, "%s: %d: line %llu: %s", __FUNCTION__, __LINE__, static_cast<unsigned long long>(reader->line_number()), e.what());
+    return JSON_CALL_PARSER_ERR;
+  }
+}
+
+call_result_t script::JSON_LinesNext(const lines_ptr_t reader, node_ptr_t *node) {
+  if (valid_readers.find(reader) == valid_readers.cend())
+    return JSON_CALL_NO_SUCH_READER_ERR;
+  return internal_JSON_LinesParse(reader, node);
+}
+
+call_result_t script::JSON_LinesRead(const lines_ptr_t reader, cell *nodes, cell *count, const cell max_count) {
+  if (valid_readers.find(reader) == valid_readers.cend())
+    return JSON_CALL_NO_SUCH_READER_ERR;
+  *count = 0;
+  while (*count < max_count) {
+    auto result = internal_JSON_LinesParse(reader, reinterpret_cast<node_ptr_t *>(&nodes[*count]));
+    if (result == JSON_CALL_NODE_NOT_EXISTS_ERR)
+      break;
+    if (result != JSON_CALL_NO_ERR)
+      return result;
+    ++*count;
+  }
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t script::JSON_LinesClose(const lines_ptr_t reader) {
+  if (valid_readers.erase(reader) == 0)
+    return JSON_CALL_NO_SUCH_READER_ERR;
+  return JSON_CALL_NO_ERR;
+}
+
+call_result_t script::JSON_SetOption(const cell option, const cell value) {
+  switch (option) {
+  case JSON_OPTION_SAVE_BUFFER_SIZE:
+    if (value < static_cast<cell>(json_file_writer::kMinBufferSize) || value > static_cast<cell>(json_file_writer::kMaxBufferSize))
+      return JSON_CALL_INVALID_OPTION_ERR;
+    json_file_writer::buffer_size = static_cast<size_t>(value);
+    return JSON_CALL_NO_ERR;
+  case JSON_OPTION_COMPRESSION_LEVEL:
+    if (value < 0 || value > LZ4HC_CLEVEL_MAX)
+      return JSON_CALL_INVALID_OPTION_ERR;
+    json_file_writer::compression_level = value;
+    return JSON_CALL_NO_ERR;
+  case JSON_OPTION_SAVE_SYNC:
+    if (value != 0 && value != 1)
+      return JSON_CALL_INVALID_OPTION_ERR;
+    json_file_writer::sync_saves = value != 0;
+    return JSON_CALL_NO_ERR;
+  case JSON_OPTION_LOG_LEVEL:
+    if (value < JSON_LOG_LEVEL_NONE || value >= JSON_LOG_LEVEL_MAX)
+      return JSON_CALL_INVALID_OPTION_ERR;
+    json_diagnostics::current_level = static_cast<JsonLogLevel>(value);
+    return JSON_CALL_NO_ERR;
+  case JSON_OPTION_LOG_RATE_LIMIT:
+    if (value < 0)
+      return JSON_CALL_INVALID_OPTION_ERR;
+    json_diagnostics::per_second_limit = static_cast<uint32_t>(value);
+    return JSON_CALL_NO_ERR;
+  default:return JSON_CALL_INVALID_OPTION_ERR;
+  }
+}
+
+call_result_t script::JSON_GetOption(const cell option, cell *value) {
+  switch (option) {
+  case JSON_OPTION_SAVE_BUFFER_SIZE:*value = static_cast<cell>(json_file_writer::buffer_size);
+    return JSON_CALL_NO_ERR;
+  case JSON_OPTION_COMPRESSION_LEVEL:*value = json_file_writer::compression_level;
+    return JSON_CALL_NO_ERR;
+  case JSON_OPTION_SAVE_SYNC:*value = json_file_writer::sync_saves;
+    return JSON_CALL_NO_ERR;
+  case JSON_OPTION_LOG_LEVEL:*value = json_diagnostics::current_level;
+    return JSON_CALL_NO_ERR;
+  case JSON_OPTION_LOG_RATE_LIMIT:*value = static_cast<cell>(json_diagnostics::per_second_limit);
+    return JSON_CALL_NO_ERR;
+  default:return JSON_CALL_INVALID_OPTION_ERR;
+  }
+}
+
+call_result_t script::JSON_StartTrace(const std::filesystem::path filename) {
+  try {
+    return json_trace_instance.start(filename);
+  } catch (const std::exception &e) {
+    LOG_EXCEPTION(e);
+    return JSON_CALL_UNKNOWN_ERR;
+  }
+}
+
+call_result_t script::JSON_StopTrace() {
+  return json_trace_instance.stop();
+}
+
 call_result_t script::JSON_Cleanup(node_ptr_t node) {
   // Silently return because node may be not initialized
   if (node == nullptr)
@@ -572,11 +2077,109 @@ call_result_t script::JSON_Cleanup(node_ptr_t node) {
   auto node_iter = valid_nodes.find(node);
   if (node_iter == valid_nodes.end())
     return JSON_CALL_NODE_NOT_EXISTS_ERR;
-  delete node;
-  valid_nodes.erase(node_iter);
+  delete internal_JSON_Unregister(node_iter);
   return JSON_CALL_NO_ERR;
 }
 
+nlohmann::ordered_json script::internal_JSON_Consume(const node_ptr_t node) {
+  internal_JSON_Materialize(node);
+  nlohmann::ordered_json value;
+  // borrowed handle points into another tree, which must be left intact
+  if (valid_nodes.find(node)->second.owner != nullptr)
+    value = *node;
+  else
+    value = std::move(*node);
+  JSON_Cleanup(node);
+  return value;
+}
+
+node_ptr_t script::internal_JSON_Resolve(const cell handle, const bool mutate) {
+  auto node = reinterpret_cast<node_ptr_t>(handle);
+  if (node == nullptr || valid_nodes.find(node) == valid_nodes.cend())
+    return nullptr;
+  internal_JSON_Materialize(node);
+  if (mutate) {
+    // other plugin may change the tree in any way, it is estimated again on next accounting
+    stale_nodes.insert(internal_JSON_Owner(node));
+    internal_JSON_Touch(node);
+  }
+  return node;
+}
+
+node_ptr_t script::internal_JSON_Take(const cell handle) {
+  auto node = reinterpret_cast<node_ptr_t>(handle);
+  auto node_iter = valid_nodes.find(node);
+  if (node == nullptr || node_iter == valid_nodes.end())
+    return nullptr;
+  internal_JSON_Materialize(node);
+  if (node_iter->second.owner != nullptr) {
+    auto copy = new nlohmann::ordered_json(*node);
+    internal_JSON_Unregister(node_iter);
+    return copy;
+  }
+  return internal_JSON_Unregister(node_iter);
+}
+
+bool script::internal_JSON_WithinQuota(const size_t bytes) {
+  if (memory_quota == 0)
+    return true;
+  internal_JSON_RefreshMemory();
+  if (memory_bytes + bytes <= memory_quota)
+    return true;
+  LOG_AT(JSON_LOG_LEVEL_ERROR, "error: allocation of %zu bytes would exceed memory quota (%zu of %zu bytes used)", bytes, memory_bytes, memory_quota);
+  return false;
+}
+
+bool script::internal_JSON_Track(node_ptr_t &node) {
+  if (memory_quota == 0) {
+    internal_JSON_Adopt(node, this);
+    return true;
+  }
+  auto bytes = internal_JSON_EstimateBytes(node);
+  if (!internal_JSON_WithinQuota(bytes)) {
+    lazy_nodes.erase(node);
+    delete node;
+    node = nullptr;
+    return false;
+  }
+  internal_JSON_Adopt(node, this, bytes);
+  return true;
+}
+
+cell script::internal_JSON_Register(const node_ptr_t node) {
+  internal_JSON_Adopt(node, nullptr);
+  return reinterpret_cast<cell>(node);
+}
+
+const json_template *script::internal_JSON_FindTemplate(const cell handle) {
+  auto item = valid_templates.find(reinterpret_cast<template_ptr_t>(handle));
+  return item != valid_templates.cend() ? item->second.get() : nullptr;
+}
+
+bool script::internal_JSON_NodeExists(const cell node) {
+  return node != JSON_INVALID_NODE && valid_nodes.find(reinterpret_cast<node_ptr_t>(node)) != valid_nodes.cend();
+}
+
+bool script::internal_JSON_HandleExists(const cell handle) {
+  return internal_JSON_NodeExists(handle)
+      || valid_layouts.find(reinterpret_cast<layout_ptr_t>(handle)) != valid_layouts.cend()
+      || valid_validators.find(reinterpret_cast<validator_ptr_t>(handle)) != valid_validators.cend()
+      || valid_logs.find(reinterpret_cast<log_ptr_t>(handle)) != valid_logs.cend()
+      || valid_readers.find(reinterpret_cast<lines_ptr_t>(handle)) != valid_readers.cend()
+      || valid_indexes.find(reinterpret_cast<index_ptr_t>(handle)) != valid_indexes.cend()
+      || valid_snapshots.find(reinterpret_cast<snapshot_ptr_t>(handle)) != valid_snapshots.cend()
+      || valid_templates.find(reinterpret_cast<template_ptr_t>(handle)) != valid_templates.cend()
+      || valid_cursors.find(reinterpret_cast<cursor_ptr_t>(handle)) != valid_cursors.cend();
+}
+
+script::~script() {
+  // trees outlive the script which allocated them, they stay in plugin-wide counters only
+  for (auto &[node, info] : valid_nodes) {
+    if (info.owner_script == this)
+      info.owner_script = nullptr;
+  }
+}
+
 bool script::OnLoad() {
   json_watcher_public = MakePublic("OnJSONFileModified", true);
   return true;
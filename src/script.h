@@ -24,6 +24,21 @@
 
 #include "common.h"
 #include "json_watcher.h"
+#include "json_trace.h"
+#include "json_fields.h"
+#include "json_schema.h"
+#include "json_log.h"
+#include "json_lines.h"
+#include "json_query.h"
+#include "json_index.h"
+#include "json_io.h"
+#include "json_memory.h"
+#include "json_lazy.h"
+#include "json_persistent.h"
+#include "json_template.h"
+#include "json_stringifier.h"
+#include "json_diagnostics.h"
+#include "json_hash.h"
 #include "iconvlite.hpp"
 
 class script : public ptl::AbstractScript<script> {
@@ -32,32 +47,73 @@ public:
    * @brief Parses JSON buffer
    * @param buffer Buffer to parse
    * @param node Output node
+   * @param lazy Whether members of object are parsed only on first access. Default: false
    * @return    JSON_CALL_NO_ERR on success
    *            JSON_CALL_PARSER_ERR on parser error
    *            JSON_CALL_NODE_NOT_EXISTS_ERR if no output node was provided
+   *            JSON_CALL_MEMORY_QUOTA_ERR if script memory quota would be exceeded
+   * @note Lazily parsed object is validated and its members are indexed at once. Keyed getters,
+   *       setters and JSON_Remove parse only the member they access, other natives parse the rest
    */
-  call_result_t       JSON_Parse(const std::string buffer, node_ptr_t *node);
+  call_result_t       JSON_Parse(const std::string buffer, node_ptr_t *node, const bool lazy);
   /**
-   * @brief Parses JSON file
+   * @brief Parses JSON file. LZ4 compressed files are detected by content and decompressed while parsing
    * @param filename Name of file to parse
    * @param node Output node
+   * @param lazy Whether members of object are parsed only on first access, see JSON_Parse. Default: false
    * @return    JSON_CALL_NO_ERR on success
    *            JSON_CALL_PARSER_ERR on parser error
    *            JSON_CALL_NODE_NOT_EXISTS_ERR if no output node was provided
    *            JSON_CALL_NO_SUCH_FILE_ERR if file not exists
+   *            JSON_CALL_MEMORY_QUOTA_ERR if script memory quota would be exceeded
    */
-  call_result_t       JSON_ParseFile(const std::filesystem::path filename, node_ptr_t *node);
+  call_result_t       JSON_ParseFile(const std::filesystem::path filename, node_ptr_t *node, const bool lazy);
+  /**
+   * @brief Parses many JSON files in parallel, see JSON_ParseFile
+   * @param paths Array of file names
+   * @param count Count of files
+   * @param nodes Output nodes, JSON_INVALID_NODE for files which failed to parse
+   * @param path_size Size of each file name
+   * @param paths_count Count of rows in paths array
+   * @param nodes_size Size of nodes array
+   * @return    JSON_CALL_NO_ERR if every file was parsed
+   *            Error of the first file which failed otherwise, see JSON_ParseFile
+   *            JSON_CALL_FORMAT_ERR if count or path size is invalid, or count exceeds paths or nodes array
+   */
+  call_result_t       JSON_ParseFilesBatch(const cell *paths, const cell count, cell *nodes, const cell path_size, const cell paths_count, const cell nodes_size);
+  /**
+   * @brief Saves many nodes in parallel, see JSON_SaveFile
+   * @param nodes Array of nodes
+   * @param paths Array of file names
+   * @param count Count of files
+   * @param results Output result of each file
+   * @param indent Count of spaces for tabulation. Default: -1
+   * @param compression JsonCompression of files. Default: JSON_COMPRESSION_AUTO
+   * @param path_size Size of each file name
+   * @param nodes_size Size of nodes array
+   * @param paths_count Count of rows in paths array
+   * @param results_size Size of results array
+   * @return    JSON_CALL_NO_ERR if every file was saved
+   *            Error of the first file which failed otherwise
+   *            JSON_CALL_FORMAT_ERR if count or path size is invalid, or count exceeds nodes, paths or results array
+   *            JSON_CALL_INVALID_OPTION_ERR if compression is invalid
+   */
+  call_result_t       JSON_SaveFilesBatch(const cell *nodes, const cell *paths, const cell count, cell *results, const cell indent, const cell compression, const cell path_size, const cell nodes_size, const cell paths_count, const cell results_size);
+  call_result_t       internal_JSON_ParseLazy(std::string text, node_ptr_t *node);
   /**
    * @brief Saves JSON node to file
    * @param filename Name of file to save in
    * @param node Node to save
    * @param indent Count of spaces for tabulation. Default: -1
-   * @return    JSON_CALL_NO_ERR on success
-   *            JSON_CALL_UNKNOWN_ERR on any exception
+   * @param skip_unchanged Do nothing if node was not modified since last successful save to the same file. Default: false
+   * @param compression Compression of file. Default: JSON_COMPRESSION_AUTO (LZ4 for ".lz4" files)
+   * @return    JSON_CALL_NO_ERR on success (or if save was skipped)
+   *            JSON_CALL_UNKNOWN_ERR if file could not be written
    *            JSON_CALL_NODE_NOT_EXISTS_ERR if no node was provided
    *            JSON_CALL_NO_SUCH_DIR_ERR if output path (not a file) does not exist
+   *            JSON_CALL_INVALID_OPTION_ERR if compression is invalid
    */
-  call_result_t       JSON_SaveFile(const std::filesystem::path filename, const node_ptr_t node, const cell indent);
+  call_result_t       JSON_SaveFile(const std::filesystem::path filename, const node_ptr_t node, const cell indent, const bool skip_unchanged, const cell compression);
   /**
    * @brief Converts JSON Node to string
    * @param node Node to convert
@@ -70,6 +126,34 @@ public:
    *            JSON_CALL_NO_RETURN_STRING_ERR if utf2cp converter did not return string
    */
   call_result_t       JSON_Stringify(const node_ptr_t node, cell *out, const cell out_size, const cell indent);
+  /**
+   * @brief Starts converting JSON Node to string in chunks, for output which does not fit into one buffer
+   * @param node Node to convert. It must not be modified until the cursor is ended
+   * @param indent Count of spaces for tabulation, -1 for compact output
+   * @param cursor Output cursor, pass it to JSON_StringifyChunk
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if node not exists
+   */
+  call_result_t       JSON_StringifyBegin(const node_ptr_t node, const cell indent, cell *cursor);
+  /**
+   * @brief Writes next chunk of output, same text as JSON_Stringify would return
+   * @param cursor Cursor
+   * @param out Output buffer, filled up to out_size - 1 characters
+   * @param length Count of written characters, 0 once whole output has been returned
+   * @param out_size Output buffer size
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NO_SUCH_CURSOR_ERR if cursor not exists
+   *            JSON_CALL_STALE_CURSOR_ERR if node was modified or released since JSON_StringifyBegin
+   *            JSON_CALL_NO_RETURN_STRING_ERR if output buffer cannot hold a single character
+   */
+  call_result_t       JSON_StringifyChunk(const cursor_ptr_t cursor, cell *out, cell *length, const cell out_size);
+  /**
+   * @brief Releases cursor
+   * @param cursor Cursor
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NO_SUCH_CURSOR_ERR if cursor not exists
+   */
+  call_result_t       JSON_StringifyEnd(const cursor_ptr_t cursor);
   /**
    * @brief Prints JsonNode to console
    * @param node Node to dump
@@ -78,6 +162,41 @@ public:
    *            JSON_CALL_NODE_NOT_EXISTS_ERR if node was not specified
    */
   call_result_t       JSON_Dump(const node_ptr_t node, const cell indent);
+  /**
+   * @brief Prints estimated memory usage and object key statistics to server log
+   * @param node Node to report on. Default: JSON_INVALID_NODE, reports all nodes owned by handles
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if node does not exist
+   * @note Duplicate key bytes are heap bytes of keys which repeat an earlier key,
+   *       i.e. what sharing equal keys between documents would save
+   */
+  call_result_t       JSON_MemoryReport(const node_ptr_t node);
+  /**
+   * @brief Estimates deep size of tree in bytes
+   * @param node Node
+   * @param bytes Output size
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if node does not exist
+   */
+  call_result_t       JSON_MemoryUsage(const node_ptr_t node, cell *bytes);
+  /**
+   * @brief Gets count and estimated size of trees owned by handles
+   * @param nodes Output count of trees
+   * @param bytes Output size of trees
+   * @param plugin_wide Whether to count trees of all scripts, otherwise of the calling one. Default: false
+   * @return    JSON_CALL_NO_ERR
+   * @note Borrowed handles point into other trees and are not counted
+   */
+  call_result_t       JSON_GetMemoryStats(cell *nodes, cell *bytes, const bool plugin_wide);
+  /**
+   * @brief Limits size of trees allocated by the calling script
+   * @param bytes Quota, 0 if unlimited
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_INVALID_OPTION_ERR if quota is negative
+   * @note Natives which would allocate past the quota fail with JSON_CALL_MEMORY_QUOTA_ERR
+   *       and return JSON_INVALID_NODE where they return a node
+   */
+  call_result_t       JSON_SetMemoryQuota(const cell bytes);
   /**
    * @brief Returns node type
    * @param node Node to check type of
@@ -130,19 +249,54 @@ public:
    * @return JsonNode
    */
   node_ptr_result_t   JSON_Array(cell *params);
+  /**
+   * @brief Constructs deep copy of node. Natives which take ownership of a node move it, so clone it first to keep using it
+   * @param node Node to copy
+   * @return    JsonNode on success
+   *            JSON_INVALID_NODE if node was not provided
+   */
+  node_ptr_result_t   JSON_Clone(const node_ptr_t node);
 
   /**
-   * @brief Appends second_node to first_node
+   * @brief Appends second_node to first_node. Second node is moved into the first one and destroyed
    * @param first_node Parent node
    * @param second_node Node to add
-   * @return    JsonNode on success
+   * @return    first_node on success
    *            JSON_CALL_WRONG_TYPE_ERR if type of first node is not the same one or if their type is not an array or object
    *            JSON_CALL_NODE_NOT_EXISTS_ERR if first or second node was not provided
    */
   node_ptr_result_t   JSON_Append(const node_ptr_t first_node, const node_ptr_t second_node);
 
+  /**
+   * @brief Builds RFC 6902 JSON Patch which turns first node into second one
+   * @param first_node Source node
+   * @param second_node Target node
+   * @param patch Output node (array of operations)
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if first/second/output node was not provided
+   */
+  call_result_t       JSON_Diff(const node_ptr_t first_node, const node_ptr_t second_node, node_ptr_t *patch);
+  /**
+   * @brief Applies RFC 6902 JSON Patch to node. Node is left untouched if any operation fails
+   * @param node Node to patch
+   * @param patch Patch node (array of operations), stays valid after call
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if node/patch was not provided
+   *            JSON_CALL_PATCH_ERR if patch is malformed or one of operations failed
+   */
+  call_result_t       JSON_ApplyPatch(node_ptr_t node, const node_ptr_t patch);
+  /**
+   * @brief Applies RFC 7386 JSON Merge Patch to node in place
+   * @param node Node to patch
+   * @param patch Merge patch node, stays valid after call
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if node/patch was not provided
+   */
+  call_result_t       JSON_ApplyMergePatch(node_ptr_t node, const node_ptr_t patch);
+
   template            <typename T>
   call_result_t       internal_JSON_SetValue(node_ptr_t node, const std::string key, const T value);
+  call_result_t       internal_JSON_MoveValue(node_ptr_t node, const std::string key, const node_ptr_t value_node);
   /**
    * @brief Sets null to JsonNode[key]
    * @param node Parent node
@@ -188,21 +342,23 @@ public:
    */
   call_result_t       JSON_SetString(node_ptr_t node, const std::string key, const std::string value);
   /**
-   * @brief Sets object to JsonNode[key]
+   * @brief Sets object to JsonNode[key]. Value node is moved into parent and destroyed
    * @param node Parent node
    * @param key Key of JsonNode in object
    * @param value_node Node to set
    * @return    JSON_CALL_NO_ERR on success
    *            JSON_CALL_NODE_NOT_EXISTS_ERR if first/second node was not provided
+   *            JSON_CALL_UNKNOWN_ERR if node is set into itself
    */
   call_result_t       JSON_SetObject(node_ptr_t node, const std::string key, const node_ptr_t value_node);
   /**
-   * @brief Sets array to JsonNode[key]
+   * @brief Sets array to JsonNode[key]. Value node is moved into parent and destroyed
    * @param node Parent node
    * @param key Key of JsonNode in object
    * @param value_node Node to set
    * @return    JSON_CALL_NO_ERR on success
    *            JSON_CALL_NODE_NOT_EXISTS_ERR if first/second node was not provided
+   *            JSON_CALL_UNKNOWN_ERR if node is set into itself
    */
   call_result_t       JSON_SetArray(node_ptr_t node, const std::string key, const node_ptr_t value_node);
 
@@ -263,6 +419,140 @@ public:
    */
   call_result_t       JSON_GetArray(node_ptr_t node, const std::string key, node_ptr_t *out);
 
+  /**
+   * @brief Gets boolean value by key without logging, for keys which may be missing
+   * @param node Parent node
+   * @param key Key of value in object
+   * @param fallback Value returned if node not exists or has no boolean by key
+   * @return    Value or fallback
+   */
+  cell                JSON_TryGetBool(node_ptr_t node, const std::string key, const bool fallback);
+  /**
+   * @brief Gets integer value by key without logging, for keys which may be missing
+   * @param node Parent node
+   * @param key Key of value in object
+   * @param fallback Value returned if node not exists or has no integer by key
+   * @return    Value or fallback
+   */
+  cell                JSON_TryGetInt(node_ptr_t node, const std::string key, const cell fallback);
+  /**
+   * @brief Gets float value by key without logging, for keys which may be missing
+   * @param node Parent node
+   * @param key Key of value in object
+   * @param fallback Value returned if node not exists or has no float by key
+   * @return    Value or fallback
+   */
+  cell                JSON_TryGetFloat(node_ptr_t node, const std::string key, const float fallback);
+  /**
+   * @brief Gets string value by key without logging, for keys which may be missing
+   * @param node Parent node
+   * @param key Key of value in object
+   * @param out Output buffer, receives fallback if node not exists or has no string by key
+   * @param out_size Output buffer size
+   * @param fallback Default string
+   * @return    true if value was found, false if fallback was written
+   */
+  cell                JSON_TryGetString(node_ptr_t node, const std::string key, cell *out, const cell out_size, const std::string fallback);
+
+  /**
+   * @brief Reads several fields of object at once into referenced variables
+   * @param params node, format ("i:money s[24]:name f:health ..."), references to output variables
+   * @return    JSON_CALL_NO_ERR if every field was read
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if node was not provided or first failed field is missing
+   *            JSON_CALL_WRONG_TYPE_ERR if node is not an object or first failed field has another type
+   *            JSON_CALL_FORMAT_ERR if format is invalid or does not match passed arguments
+   */
+  call_result_t       JSON_GetMany(const cell *params);
+  /**
+   * @brief Sets several fields of object at once from referenced variables
+   * @param params node, format ("i:money s[24]:name f:health ..."), references to input variables
+   * @return    JSON_CALL_NO_ERR if every field was set
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if node was not provided or JsonNode passed for 'j' field not exists
+   *            JSON_CALL_WRONG_TYPE_ERR if node is not an object
+   *            JSON_CALL_FORMAT_ERR if format is invalid or does not match passed arguments
+   */
+  call_result_t       JSON_SetMany(const cell *params);
+  /**
+   * @brief Returns per-field results of last JSON_GetMany/JSON_SetMany call
+   * @param out Output array of JsonCallResult in format order
+   * @param out_size Output array size
+   * @return Count of fields in last call
+   */
+  cell                JSON_GetFieldErrors(cell *out, const cell out_size);
+
+  call_result_t       internal_JSON_GetField(const nlohmann::ordered_json &parent, const json_fields::field &field, cell *out);
+  call_result_t       internal_JSON_SetField(nlohmann::ordered_json &parent, const json_fields::field &field, const cell *value);
+  size_t              internal_JSON_SetManyBytes(const node_ptr_t node, const json_fields &spec, const cell *args);
+
+  /**
+   * @brief Defines memory layout of enum-indexed Pawn array (same syntax as JSON_GetMany format)
+   * @param spec Layout spec, e.g. "i:money s[24]:name x[2] f:health"
+   * @return    JsonLayout on success
+   *            JSON_INVALID_NODE if spec is invalid or has JsonNode fields
+   */
+  node_ptr_result_t   JSON_DefineLayout(const std::string spec);
+  /**
+   * @brief Creates object from Pawn array described by layout
+   * @param layout Layout of array
+   * @param data Array to read from
+   * @param node Output node
+   * @param data_size Array size
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if no output node was provided
+   *            JSON_CALL_FORMAT_ERR if layout not exists or does not fit into array
+   */
+  call_result_t       JSON_FromLayout(const layout_ptr_t layout, const cell *data, node_ptr_t *node, const cell data_size);
+  /**
+   * @brief Writes fields of object into Pawn array described by layout. Missing fields are left untouched
+   * @param node Node to read from
+   * @param layout Layout of array
+   * @param data Output array
+   * @param data_size Array size
+   * @return    JSON_CALL_NO_ERR if every field was written
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if node was not provided or first failed field is missing
+   *            JSON_CALL_WRONG_TYPE_ERR if node is not an object or first failed field has another type
+   *            JSON_CALL_FORMAT_ERR if layout not exists or does not fit into array
+   */
+  call_result_t       JSON_ToLayout(const node_ptr_t node, const layout_ptr_t layout, cell *data, const cell data_size);
+
+  /**
+   * @brief Compiles JSON Schema (draft-07 subset) into reusable validator
+   * @param schema Schema node
+   * @return    JsonValidator on success
+   *            JSON_INVALID_NODE if schema node not exists or schema is malformed/unsupported
+   */
+  node_ptr_result_t   JSON_CompileSchema(const node_ptr_t schema);
+  /**
+   * @brief Validates node against compiled schema
+   * @param validator Validator
+   * @param node Node to validate
+   * @param out Output buffer for description of the first violation
+   * @param out_size Output buffer size
+   * @return    JSON_CALL_NO_ERR if node is valid
+   *            JSON_CALL_VALIDATION_ERR if node is invalid
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if node was not provided
+   *            JSON_CALL_NO_SUCH_VALIDATOR_ERR if validator not exists
+   */
+  call_result_t       JSON_Validate(const validator_ptr_t validator, const node_ptr_t node, cell *out, const cell out_size);
+  /**
+   * @brief Destroys compiled validator
+   * @param validator Validator
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NO_SUCH_VALIDATOR_ERR if validator not exists
+   */
+  call_result_t       JSON_DestroyValidator(const validator_ptr_t validator);
+
+  /**
+   * @brief Evaluates query (JMESPath subset) against node, e.g. "vehicles[?owner=='X' && fuel<`10`].id". Compiled queries are cached
+   * @param node Node to query
+   * @param query Query
+   * @param result Output node, null node if nothing matched
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if node/output node was not provided
+   *            JSON_CALL_FORMAT_ERR if query has a syntax error
+   */
+  call_result_t       JSON_Query(const node_ptr_t node, const std::string query, node_ptr_t *result);
+
   /**
    * @brief Gets type of JsonNode from object by provided key
    * @param node Parent node
@@ -359,6 +649,180 @@ public:
    */
   call_result_t       JSON_Remove(node_ptr_t node, const std::string key);
 
+  /**
+   * @brief Sorts array in place by value found at key path of each item. Items without such value are ordered as null,
+   * NaN is ordered after every other number
+   * @param node Node (array)
+   * @param key_path Dot-separated keys within item, e.g. "stats.score". Empty path sorts by items themselves
+   * @param order Sort order
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_WRONG_TYPE_ERR if node is not an array or order is invalid
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if node was not provided
+   */
+  call_result_t       JSON_ArraySort(node_ptr_t node, const std::string key_path, const cell order);
+  /**
+   * @brief Finds first item whose value at key path equals to value, scanning from start index
+   * @param node Node (array)
+   * @param key_path Dot-separated keys within item. Empty path compares items themselves
+   * @param value Value to look for
+   * @param index Index of found item, -1 if not found
+   * @param start Index to start from
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_WRONG_TYPE_ERR if node is not an array
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if node/value was not provided or no item matches
+   */
+  call_result_t       JSON_ArrayFind(const node_ptr_t node, const std::string key_path, const node_ptr_t value, cell *index, const cell start);
+  /**
+   * @brief Finds item whose value at key path equals to value in array sorted by JSON_ArraySort with same key path and order
+   * @param node Node (sorted array)
+   * @param key_path Dot-separated keys within item. Empty path compares items themselves
+   * @param value Value to look for
+   * @param index Index of found item, or index where value would be inserted if not found
+   * @param order Sort order of array
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_WRONG_TYPE_ERR if node is not an array or order is invalid
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if node/value was not provided or no item matches
+   */
+  call_result_t       JSON_ArrayBinarySearch(const node_ptr_t node, const std::string key_path, const node_ptr_t value, cell *index, const cell order);
+
+  /**
+   * @brief Creates hash index over array of objects by value at key pointer of each element.
+   * JSON_ArrayAppend, JSON_ArrayAppendEx, JSON_ArrayRemoveIndex and JSON_ArrayClear update it in place,
+   * other changes of node make it rebuild on next lookup. Index is destroyed together with node
+   * @param node Node which is or contains indexed array
+   * @param key_pointer JSON pointer to the indexed value within element, e.g. "/id"
+   * @param array_key Key of indexed array within node, empty if node itself is the array
+   * @return    JsonIndex on success
+   *            JSON_INVALID_NODE if node was not provided or is borrowed, array not exists or pointer is invalid
+   */
+  node_ptr_result_t   JSON_CreateIndex(const node_ptr_t node, const std::string key_pointer, const std::string array_key);
+  /**
+   * @brief Looks up element by indexed value. Element is a borrowed handle: it refers to the element inside indexed node
+   * without copying it, and stays valid until indexed node is changed by anything but the element handle itself
+   * @param index Index
+   * @param value Value to look for
+   * @param element Output borrowed node
+   * @param position Position of element in array
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NO_SUCH_INDEX_ERR if index not exists
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if value was not provided or there is no such element
+   */
+  call_result_t       JSON_IndexLookup(const index_ptr_t index, const node_ptr_t value, node_ptr_t *element, cell *position);
+  call_result_t       JSON_IndexLookupInt(const index_ptr_t index, const cell value, node_ptr_t *element, cell *position);
+  call_result_t       JSON_IndexLookupString(const index_ptr_t index, const std::string value, node_ptr_t *element, cell *position);
+  call_result_t       internal_JSON_IndexLookup(const index_ptr_t index, const nlohmann::ordered_json &value, node_ptr_t *element, cell *position);
+  /**
+   * @brief Destroys index
+   * @param index Index
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NO_SUCH_INDEX_ERR if index not exists
+   */
+  call_result_t       JSON_DestroyIndex(const index_ptr_t index);
+
+  /**
+   * @brief Creates immutable snapshot of node. Snapshots share unchanged subtrees with each other,
+   * so cloning a snapshot is O(1) and changing it copies only containers on the changed path.
+   * Creating a snapshot itself copies the whole node, O(n) with one allocation per value
+   * @param node Node to copy
+   * @return    Snapshot on success
+   *            JSON_INVALID_NODE if node was not provided
+   */
+  node_ptr_result_t   JSON_SnapshotCreate(const node_ptr_t node);
+  /**
+   * @brief Creates snapshot sharing whole document with given one
+   * @param snapshot Snapshot
+   * @return    Snapshot on success
+   *            JSON_INVALID_NODE if snapshot not exists
+   */
+  node_ptr_result_t   JSON_SnapshotClone(const snapshot_ptr_t snapshot);
+  /**
+   * @brief Copies value at key path out of snapshot into a regular node
+   * @param snapshot Snapshot
+   * @param key_path Dot separated object keys or array positions, empty for the whole document
+   * @param node Output node
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NO_SUCH_SNAPSHOT_ERR if snapshot not exists
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if there is no value at key path or no output node was provided
+   */
+  call_result_t       JSON_SnapshotGet(const snapshot_ptr_t snapshot, const std::string key_path, node_ptr_t *node);
+  /**
+   * @brief Sets value at key path of snapshot. Other snapshots sharing the changed path are not affected
+   * @param snapshot Snapshot
+   * @param key_path Dot separated object keys or array positions, empty for the whole document.
+   *                 Missing object members on the path are created as objects
+   * @param value Node to move into snapshot
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NO_SUCH_SNAPSHOT_ERR if snapshot not exists
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if value was not provided or key path leads through
+   *            a value which is not a container or through a missing array position
+   */
+  call_result_t       JSON_SnapshotSet(const snapshot_ptr_t snapshot, const std::string key_path, const node_ptr_t value);
+  /**
+   * @brief Removes value at key path of snapshot. Other snapshots are not affected
+   * @param snapshot Snapshot
+   * @param key_path Dot separated object keys or array positions
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NO_SUCH_SNAPSHOT_ERR if snapshot not exists
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if there is no value at key path
+   */
+  call_result_t       JSON_SnapshotRemove(const snapshot_ptr_t snapshot, const std::string key_path);
+  /**
+   * @brief Destroys snapshot. Subtrees shared with other snapshots stay alive
+   * @param snapshot Snapshot
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NO_SUCH_SNAPSHOT_ERR if snapshot not exists
+   */
+  call_result_t       JSON_SnapshotDestroy(const snapshot_ptr_t snapshot);
+  /**
+   * @brief Saves snapshot to file like JSON_SaveFile does, without copying it into a node first
+   * @param filename Name of file to save in
+   * @param snapshot Snapshot
+   * @param indent Count of spaces for tabulation. Default: -1
+   * @param compression Compression of file. Default: JSON_COMPRESSION_AUTO (LZ4 for ".lz4" files)
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_UNKNOWN_ERR if file could not be written
+   *            JSON_CALL_NO_SUCH_SNAPSHOT_ERR if snapshot not exists
+   *            JSON_CALL_NO_SUCH_DIR_ERR if output path (not a file) does not exist
+   *            JSON_CALL_INVALID_OPTION_ERR if compression is invalid
+   */
+  call_result_t       JSON_SnapshotSave(const std::filesystem::path filename, const snapshot_ptr_t snapshot, const cell indent, const cell compression);
+  /**
+   * @brief Builds RFC 6902 JSON Patch which turns first snapshot into second one, like JSON_Diff.
+   * Subtrees the snapshots share are skipped, so diffing a clone against its original costs as much as the changes
+   * @param first Source snapshot
+   * @param second Target snapshot
+   * @param patch Output node (array of operations)
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NO_SUCH_SNAPSHOT_ERR if first or second snapshot not exists
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if no output node was provided
+   */
+  call_result_t       JSON_SnapshotDiff(const snapshot_ptr_t first, const snapshot_ptr_t second, node_ptr_t *patch);
+
+  /**
+   * @brief Compiles output template, e.g. "{\"user\":%s,\"id\":%d}"
+   * @param text Template with placeholders %s, %d, %f, %b, %j and %%, see json_template
+   * @return    JsonTemplate on success
+   *            JSON_INVALID_NODE if template has unknown placeholder or does not render valid JSON
+   */
+  node_ptr_result_t   JSON_CompileTemplate(const std::string text);
+  /**
+   * @brief Renders template with arguments straight into output, without building a tree
+   * @param params Raw params: template, output, output size, and one argument per placeholder
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NO_SUCH_TEMPLATE_ERR if template not exists
+   *            JSON_CALL_FORMAT_ERR if count of arguments does not match template
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if node passed for %j not exists
+   *            JSON_CALL_NO_RETURN_STRING_ERR if output does not fit, output is left empty
+   */
+  call_result_t       JSON_RenderTemplate(const cell *params);
+  /**
+   * @brief Destroys template
+   * @param tpl Template
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NO_SUCH_TEMPLATE_ERR if template not exists
+   */
+  call_result_t       JSON_DestroyTemplate(const template_ptr_t tpl);
+
   /**
    * @brief Gets a boolean value of native JsonNode
    * @param node Node
@@ -398,6 +862,34 @@ public:
    */
   call_result_t       JSON_GetNodeString(node_ptr_t node, cell *out, cell out_size);
 
+  /**
+   * @brief Gets modification counter of node, it is increased by every native which modifies node
+   * @param node Node
+   * @param out Output value
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if node was not provided
+   */
+  call_result_t       JSON_GetRevision(const node_ptr_t node, cell *out);
+  /**
+   * @brief Computes canonical 64-bit structural hash, see json_hash. Cached until the tree is modified
+   * @param node Node
+   * @param high Output upper 32 bits
+   * @param low Output lower 32 bits
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if node not exists
+   * @note Changes made by other plugins through YAPJ_API are not tracked and leave stale hashes
+   */
+  call_result_t       JSON_Hash(const node_ptr_t node, cell *high, cell *low);
+  /**
+   * @brief Compares nodes like JSON_ArrayRemove does. Differing cached hashes reject without a deep comparison
+   * @param node Node
+   * @param other Node to compare with
+   * @param out Output value, members of objects must also be in the same order to be equal
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if any of nodes not exists
+   */
+  call_result_t       JSON_Equal(const node_ptr_t node, const node_ptr_t other, bool *out);
+
   /**
    * @brief Starts a JSON watcher to track file changes
    * @param filename Name of JSON file
@@ -413,6 +905,112 @@ public:
    */
   call_result_t       JSON_StopWatcher(const std::filesystem::path filename);
 
+  /**
+   * @brief Opens JSON Lines file for appending. Records are written by background thread in batches
+   * @param filename Name of log file
+   * @param flush_interval Max time in milliseconds between writes of appended records
+   * @param sync When written batches should be synced to disk
+   * @return    JsonLog on success
+   *            JSON_INVALID_NODE if file could not be opened
+   */
+  node_ptr_result_t   JSON_LogOpen(const std::filesystem::path filename, const cell flush_interval, const cell sync);
+  /**
+   * @brief Serializes node as a single line into log buffer
+   * @param log Log
+   * @param node Node to append
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if node was not provided
+   *            JSON_CALL_NO_SUCH_LOG_ERR if log not exists
+   *            JSON_CALL_UNKNOWN_ERR if node could not be serialized or previous write failed
+   */
+  call_result_t       JSON_LogAppend(const log_ptr_t log, const node_ptr_t node);
+  /**
+   * @brief Waits until every appended record is written
+   * @param log Log
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NO_SUCH_LOG_ERR if log not exists
+   *            JSON_CALL_UNKNOWN_ERR if write failed
+   */
+  call_result_t       JSON_LogFlush(const log_ptr_t log);
+  /**
+   * @brief Writes pending records and closes log
+   * @param log Log
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NO_SUCH_LOG_ERR if log not exists
+   */
+  call_result_t       JSON_LogClose(const log_ptr_t log);
+  static void         internal_JSON_CloseLogs();
+
+  /**
+   * @brief Opens JSON Lines file for sequential reading
+   * @param filename Name of file
+   * @return    JsonLines on success
+   *            JSON_INVALID_NODE if file could not be opened
+   */
+  node_ptr_result_t   JSON_LinesOpen(const std::filesystem::path filename);
+  /**
+   * @brief Parses next record of JSON Lines file. Blank lines are skipped
+   * @param reader Reader
+   * @param node Output node. If it holds an existing node, that node is overwritten instead of allocating a new one
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NODE_NOT_EXISTS_ERR if there are no more records
+   *            JSON_CALL_NO_SUCH_READER_ERR if reader not exists
+   *            JSON_CALL_PARSER_ERR if record could not be parsed. The record is skipped
+   */
+  call_result_t       JSON_LinesNext(const lines_ptr_t reader, node_ptr_t *node);
+  /**
+   * @brief Parses up to max_count next records of JSON Lines file into nodes array. Existing nodes in the array are overwritten
+   * @param reader Reader
+   * @param nodes Output nodes
+   * @param count Count of parsed records
+   * @param max_count Size of nodes array
+   * @return    JSON_CALL_NO_ERR on success, count is less than max_count when end of file is reached
+   *            JSON_CALL_NO_SUCH_READER_ERR if reader not exists
+   *            JSON_CALL_PARSER_ERR if record could not be parsed. Reading stops after the broken record
+   */
+  call_result_t       JSON_LinesRead(const lines_ptr_t reader, cell *nodes, cell *count, const cell max_count);
+  /**
+   * @brief Closes JSON Lines reader
+   * @param reader Reader
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NO_SUCH_READER_ERR if reader not exists
+   */
+  call_result_t       JSON_LinesClose(const lines_ptr_t reader);
+  call_result_t       internal_JSON_LinesParse(const lines_ptr_t reader, node_ptr_t *node);
+
+  /**
+   * @brief Sets plugin-wide option
+   * @param option Option
+   * @param value Value to set
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_INVALID_OPTION_ERR if option not exists or value is out of range
+   */
+  call_result_t       JSON_SetOption(const cell option, const cell value);
+  /**
+   * @brief Gets plugin-wide option
+   * @param option Option
+   * @param value Output value
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_INVALID_OPTION_ERR if option not exists
+   */
+  call_result_t       JSON_GetOption(const cell option, cell *value);
+
+  /**
+   * @brief Starts recording every YAPJ native call into a binary trace file
+   * @param filename Name of trace file
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_TRACE_EXISTS_ERR if trace is already being recorded
+   *            JSON_CALL_NO_SUCH_DIR_ERR if output path (not a file) does not exist
+   *            JSON_CALL_UNKNOWN_ERR if file could not be opened
+   */
+  call_result_t       JSON_StartTrace(const std::filesystem::path filename);
+  /**
+   * @brief Stops recording native calls and flushes trace file
+   * @return    JSON_CALL_NO_ERR on success
+   *            JSON_CALL_NO_SUCH_TRACE_ERR if trace is not being recorded
+   */
+  call_result_t       JSON_StopTrace();
+
   /**
    * @brief ONLY FOR INTERNAL USAGE! Destroys allocated JsonNode.
    * @param node Node
@@ -420,11 +1018,49 @@ public:
    *            JSON_CALL_NODE_NOT_EXISTS_ERR if node was not provided
    */
   call_result_t       JSON_Cleanup(node_ptr_t node);
+  /**
+   * @brief Takes value of node which is passed to a consuming native and destroys the handle.
+   * Owned trees are moved out, borrowed ones are copied
+   */
+  nlohmann::ordered_json internal_JSON_Consume(const node_ptr_t node);
 
+  /**
+   * @brief Dispatches native call and records it into trace if it is being recorded
+   * @param params Raw native params
+   * @return Result of native
+   */
+  template            <auto func, json_trace::variadic_layout layout = json_trace::variadic_layout::none>
+  cell                internal_JSON_TraceNative(cell *params);
+  static bool         internal_JSON_NodeExists(const cell node);
+  static bool         internal_JSON_HandleExists(const cell handle);
+  /**
+   * @brief Handle access for other plugins (see YAPJ_API.h)
+   */
+  static node_ptr_t   internal_JSON_Resolve(const cell handle, const bool mutate);
+  static node_ptr_t   internal_JSON_Take(const cell handle);
+  static cell         internal_JSON_Register(const node_ptr_t node);
+  static const json_template *internal_JSON_FindTemplate(const cell handle);
+  /**
+   * @brief Checks whether the script may allocate bytes more
+   */
+  bool                internal_JSON_WithinQuota(const size_t bytes);
+  /**
+   * @brief Registers tree allocated by the script, deletes it and resets node if quota is exceeded
+   */
+  bool                internal_JSON_Track(node_ptr_t &node);
+
+  ~script();
 
   bool OnLoad();
   bool OnProcessTick();
 
+  std::vector<call_result_t> field_errors;
+
+  // accounting of trees allocated by the script
+  size_t memory_nodes{0};
+  size_t memory_bytes{0};
+  size_t memory_quota{0};
+
   bool json_watcher_handler(const std::filesystem::path &filename, const JsonWatcherFileState state);
   std::shared_ptr<ptl::Public> json_watcher_public{nullptr};
   json_watcher json_watcher_instance;
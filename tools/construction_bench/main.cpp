@@ -0,0 +1,119 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "mock_amx.h"
+#include "plugin.h"
+#include <iostream>
+#include <iomanip>
+
+// Times building documents through consuming natives, to compare plugin builds against each other
+namespace {
+constexpr size_t kAmxCells = 1024 * 1024;
+constexpr size_t kPayloadItems = 16;
+
+class bench_script {
+  mock_amx amx{kAmxCells};
+  std::vector<cell> params;
+public:
+  bench_script() { plugin::DoAmxLoad(amx.get()); }
+  ~bench_script() { plugin::DoAmxUnload(amx.get()); }
+
+  cell call(const char *name, const std::vector<cell> &args) {
+    static std::unordered_map<std::string, AMX_NATIVE> natives;
+    auto &native = natives[name];
+    if (native == nullptr && (native = mock_amx::find_native(name)) == nullptr)
+      throw std::runtime_error(std::string("native is not registered: ") + name);
+    params.assign(1, static_cast<cell>(args.size() * sizeof(cell)));
+    params.insert(params.end(), args.begin(), args.end());
+    auto result = native(amx.get(), params.data());
+    amx.reset();
+    return result;
+  }
+  // variadic arguments are passed by reference
+  cell ref(cell value) {
+    auto amx_addr = amx.allot(1);
+    *amx.phys(amx_addr) = value;
+    return amx_addr;
+  }
+  cell string(const std::string &value) { return amx.push_string(value); }
+
+  cell payload() {
+    std::vector<cell> items;
+    for (size_t i = 0; i < kPayloadItems; ++i)
+      items.push_back(call("JSON_Int", {static_cast<cell>(i)}));
+    std::vector<cell> refs;
+    for (auto item : items)
+      refs.push_back(ref(item));
+    return call("JSON_Array", refs);
+  }
+};
+
+// node = {"payload": [...], "child": node}, innermost level first
+void nested(bench_script &script, size_t levels) {
+  auto node = script.call("JSON_Object", {});
+  for (size_t i = 0; i < levels; ++i) {
+    auto payload = script.payload();
+    node = script.call("JSON_Object", {script.string("payload"), script.ref(payload), script.string("child"), script.ref(node)});
+  }
+  script.call("JSON_Cleanup", {node});
+}
+
+// result = JSON_Append(result, [...]) repeatedly
+void append(bench_script &script, size_t chunks) {
+  auto node = script.call("JSON_Array", {});
+  for (size_t i = 0; i < chunks; ++i)
+    node = script.call("JSON_Append", {node, script.payload()});
+  script.call("JSON_Cleanup", {node});
+}
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<size_t> sizes{250, 500, 1000, 2000};
+  if (argc > 1) {
+    sizes.clear();
+    for (int i = 1; i < argc; ++i)
+      sizes.push_back(std::stoul(argv[i]));
+  }
+  if (!plugin::DoLoad(mock_amx::plugin_data(true))) {
+    std::cerr << "failed to load plugin" << std::endl;
+    return 1;
+  }
+  int exit_code = 0;
+  try {
+    bench_script script;
+    std::cout << std::left << std::setw(10) << "workload" << std::right << std::setw(10) << "size" << std::setw(12) << "ms" << '\n';
+    for (auto [name, workload] : {std::make_pair("nested", &nested), std::make_pair("append", &append)}) {
+      for (auto size : sizes) {
+        auto started = std::chrono::steady_clock::now();
+        workload(script, size);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - started;
+        std::cout << std::left << std::setw(10) << name << std::right << std::setw(10) << size
+                  << std::setw(12) << std::fixed << std::setprecision(2) << elapsed.count() << '\n';
+      }
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    exit_code = 1;
+  }
+  plugin::DoUnload();
+  return exit_code;
+}
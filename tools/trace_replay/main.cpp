@@ -0,0 +1,298 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "mock_amx.h"
+#include "plugin.h"
+#include <iostream>
+#include <iomanip>
+#include <map>
+
+namespace {
+constexpr size_t kAmxCells = 4 * 1024 * 1024;
+constexpr size_t kRefCells = 64 * 1024; // room for output buffers passed by reference, shrunk when a call has many refs
+
+struct trace_native {
+  std::string name;
+  json_trace::variadic_layout layout;
+  AMX_NATIVE func;
+};
+
+struct trace_arg {
+  json_trace::arg_kind kind;
+  uint8_t flags{0};
+  cell value{0};
+  cell out{0};
+  std::string text;
+};
+
+struct trace_record {
+  uint16_t native_id;
+  uint16_t amx_id;
+  uint64_t start_ns;
+  uint32_t duration_ns;
+  cell result;
+  uint8_t result_is_handle;
+  std::vector<trace_arg> args;
+};
+
+struct native_stats {
+  uint64_t calls{0};
+  uint64_t recorded_ns{0};
+  uint64_t replayed_ns{0};
+  uint64_t diverged{0};
+};
+
+class trace_reader {
+  std::ifstream stream;
+public:
+  explicit trace_reader(const std::filesystem::path &filename) : stream(filename, std::ifstream::binary) {}
+
+  template <typename T>
+  bool read(T &value) {
+    return static_cast<bool>(stream.read(reinterpret_cast<char *>(&value), sizeof(T)));
+  }
+
+  bool read(std::string &value, size_t length) {
+    value.resize(length);
+    return static_cast<bool>(stream.read(value.data(), static_cast<std::streamsize>(length)));
+  }
+
+  bool read_header(std::vector<trace_native> &natives) {
+    char magic[sizeof(json_trace::kMagic)];
+    uint32_t version, count;
+    if (!stream.read(magic, sizeof(magic)) || std::memcmp(magic, json_trace::kMagic, sizeof(magic)) != 0)
+      return false;
+    if (!read(version) || version != json_trace::kFormatVersion || !read(count))
+      return false;
+    natives.resize(count);
+    for (auto &native : natives) {
+      uint16_t length;
+      if (!read(length) || !read(native.name, length) || !read(native.layout))
+        return false;
+      native.func = mock_amx::find_native(native.name);
+    }
+    return true;
+  }
+
+  bool read_record(trace_record &record) {
+    uint32_t argc;
+    if (!read(record.native_id) || !read(record.amx_id) || !read(record.start_ns) || !read(record.duration_ns)
+        || !read(record.result) || !read(record.result_is_handle) || !read(argc))
+      return false;
+    record.args.resize(argc);
+    for (auto &arg : record.args) {
+      if (!read(arg.kind))
+        return false;
+      switch (arg.kind) {
+      case json_trace::arg_kind::value:
+      case json_trace::arg_kind::handle:
+        if (!read(arg.value))
+          return false;
+        break;
+      case json_trace::arg_kind::string: {
+        uint32_t length;
+        if (!read(length) || !read(arg.text, length))
+          return false;
+        break;
+      }
+      case json_trace::arg_kind::ref:
+        if (!read(arg.flags) || !read(arg.value) || !read(arg.out))
+          return false;
+        break;
+      default:
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+class trace_replayer {
+  const std::vector<trace_native> &natives;
+  std::map<uint16_t, std::unique_ptr<mock_amx>> scripts;
+  std::unordered_map<cell, cell> handles; // recorded handle -> live handle
+  std::vector<native_stats> stats;
+  std::vector<cell> params;
+  std::vector<std::pair<cell, const trace_arg *>> refs;
+
+  mock_amx &script_for(uint16_t amx_id) {
+    auto &amx = scripts[amx_id];
+    if (!amx) {
+      amx = std::make_unique<mock_amx>(kAmxCells);
+      plugin::DoAmxLoad(amx->get());
+    }
+    return *amx;
+  }
+
+  cell translate(cell recorded) const {
+    auto handle = handles.find(recorded);
+    return handle != handles.cend() ? handle->second : JSON_INVALID_NODE;
+  }
+public:
+  explicit trace_replayer(const std::vector<trace_native> &natives) : natives(natives), stats(natives.size()) {}
+
+  ~trace_replayer() {
+    for (auto &[amx_id, amx] : scripts)
+      plugin::DoAmxUnload(amx->get());
+  }
+
+  bool replay(const trace_record &record) {
+    if (record.native_id >= natives.size() || natives[record.native_id].func == nullptr)
+      return false;
+    auto &amx = script_for(record.amx_id);
+    amx.reset();
+    params.assign(record.args.size() + 1, 0);
+    params[0] = static_cast<cell>(record.args.size() * sizeof(cell));
+    refs.clear();
+    // output buffer sizes are not recorded, so refs of a call share what strings leave free
+    size_t ref_count = 0, string_cells = 0;
+    for (const auto &arg : record.args) {
+      if (arg.kind == json_trace::arg_kind::string)
+        string_cells += arg.text.size() + 1;
+      else if (arg.kind == json_trace::arg_kind::ref && !(arg.flags & json_trace::kRefNull))
+        ++ref_count;
+    }
+    auto free_cells = amx.available() > string_cells ? amx.available() - string_cells : 0;
+    auto ref_cells = ref_count != 0 ? std::min(kRefCells, free_cells / ref_count) : kRefCells;
+    for (size_t i = 0; i < record.args.size(); ++i) {
+      const auto &arg = record.args[i];
+      switch (arg.kind) {
+      case json_trace::arg_kind::value:
+        params[i + 1] = arg.value;
+        break;
+      case json_trace::arg_kind::handle:
+        params[i + 1] = translate(arg.value);
+        break;
+      case json_trace::arg_kind::string:
+        params[i + 1] = amx.push_string(arg.text);
+        break;
+      case json_trace::arg_kind::ref:
+        if (arg.flags & json_trace::kRefNull)
+          break;
+        params[i + 1] = amx.allot(std::max<size_t>(1, ref_cells));
+        *amx.phys(params[i + 1]) = (arg.flags & json_trace::kRefInHandle) ? translate(arg.value) : arg.value;
+        refs.emplace_back(params[i + 1], &arg);
+        break;
+      }
+    }
+    auto started = std::chrono::steady_clock::now();
+    auto result = natives[record.native_id].func(amx.get(), params.data());
+    auto elapsed = std::chrono::steady_clock::now() - started;
+
+    auto &native_stat = stats[record.native_id];
+    ++native_stat.calls;
+    native_stat.recorded_ns += record.duration_ns;
+    native_stat.replayed_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    if (record.result_is_handle) {
+      handles[record.result] = result;
+    } else if (result != record.result) {
+      ++native_stat.diverged;
+    }
+    for (const auto &[amx_addr, arg] : refs) {
+      if (arg->flags & json_trace::kRefOutHandle)
+        handles[arg->out] = *amx.phys(amx_addr);
+    }
+    return true;
+  }
+
+  void reset_handles() { handles.clear(); }
+
+  void report(std::ostream &out) const {
+    out << std::left << std::setw(28) << "native" << std::right
+        << std::setw(10) << "calls"
+        << std::setw(16) << "recorded ns/op"
+        << std::setw(16) << "replayed ns/op"
+        << std::setw(10) << "diverged" << '\n';
+    for (size_t i = 0; i < natives.size(); ++i) {
+      const auto &native_stat = stats[i];
+      if (native_stat.calls == 0)
+        continue;
+      out << std::left << std::setw(28) << natives[i].name << std::right
+          << std::setw(10) << native_stat.calls
+          << std::setw(16) << native_stat.recorded_ns / native_stat.calls
+          << std::setw(16) << native_stat.replayed_ns / native_stat.calls
+          << std::setw(10) << native_stat.diverged << '\n';
+    }
+  }
+};
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0] << " <trace file> [--repeat N] [--quiet]" << std::endl;
+    return 1;
+  }
+  size_t repeat = 1;
+  bool quiet = false;
+  for (int i = 2; i < argc; ++i) {
+    std::string option = argv[i];
+    if (option == "--repeat" && i + 1 < argc) {
+      repeat = std::max<size_t>(1, std::stoul(argv[++i]));
+    } else if (option == "--quiet") {
+      quiet = true;
+    } else {
+      std::cerr << "unknown option: " << option << std::endl;
+      return 1;
+    }
+  }
+
+  if (!plugin::DoLoad(mock_amx::plugin_data(quiet))) {
+    std::cerr << "failed to load plugin" << std::endl;
+    return 1;
+  }
+
+  int exit_code = 0;
+  std::vector<trace_native> natives;
+  if (!trace_reader(argv[1]).read_header(natives)) {
+    std::cerr << "invalid trace file: " << argv[1] << std::endl;
+    exit_code = 1;
+  } else {
+    trace_replayer replayer(natives);
+    for (size_t pass = 0; pass < repeat && exit_code == 0; ++pass) {
+      trace_reader reader(argv[1]);
+      std::vector<trace_native> header;
+      reader.read_header(header);
+      trace_record record;
+      for (size_t index = 0; reader.read_record(record); ++index) {
+        bool replayed;
+        try {
+          replayed = replayer.replay(record);
+        } catch (const std::exception &e) {
+          // e.g. a call with more arguments than the mock AMX has room for; later calls may miss its results
+          std::cerr << "record #" << index << " (" << natives[record.native_id].name << ") skipped: " << e.what() << std::endl;
+          continue;
+        }
+        if (!replayed) {
+          std::cerr << "native #" << record.native_id << " is not registered by plugin" << std::endl;
+          exit_code = 1;
+          break;
+        }
+      }
+      replayer.reset_handles();
+    }
+    if (exit_code == 0)
+      replayer.report(std::cout);
+  }
+
+  plugin::DoUnload();
+  return exit_code;
+}
@@ -0,0 +1,197 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "mock_amx.h"
+#include <cstdarg>
+#include <cstdio>
+
+namespace {
+std::unordered_map<std::string, AMX_NATIVE> registered_natives;
+std::array<void *, PLUGIN_AMX_EXPORT_UTF8Put + 1> amx_exports{};
+std::array<void *, PLUGIN_DATA_CALLPUBLIC_GM + 1> plugin_data_table{};
+bool quiet_log = false;
+
+constexpr ucell kUnpackedMax = (1u << ((sizeof(cell) - 1) * 8)) - 1;
+
+void AMXAPI mock_logprintf(const char *format, ...) {
+  if (quiet_log)
+    return;
+  va_list args;
+  va_start(args, format);
+  std::vprintf(format, args);
+  va_end(args);
+  std::putchar('\n');
+}
+
+int AMXAPI mock_Register(AMX *, const AMX_NATIVE_INFO *list, int number) {
+  for (int i = 0; (number == -1 || i < number) && list[i].name != nullptr; ++i) {
+    registered_natives[list[i].name] = list[i].func;
+  }
+  return AMX_ERR_NONE;
+}
+
+int AMXAPI mock_GetAddr(AMX *amx, cell amx_addr, cell **phys_addr) {
+  *phys_addr = reinterpret_cast<cell *>(amx->data + amx_addr);
+  return AMX_ERR_NONE;
+}
+
+int AMXAPI mock_StrLen(const cell *cstring, int *length) {
+  int len = 0;
+  if (static_cast<ucell>(*cstring) > kUnpackedMax) {
+    while (reinterpret_cast<const char *>(cstring)[len] != '\0')
+      ++len;
+  } else {
+    while (cstring[len] != 0)
+      ++len;
+  }
+  *length = len;
+  return AMX_ERR_NONE;
+}
+
+int AMXAPI mock_GetString(char *dest, const cell *source, int, size_t size) {
+  size_t i = 0;
+  if (static_cast<ucell>(*source) > kUnpackedMax) {
+    auto bytes = reinterpret_cast<const char *>(source);
+    for (; i + 1 < size && bytes[i] != '\0'; ++i)
+      dest[i] = bytes[i];
+  } else {
+    for (; i + 1 < size && source[i] != 0; ++i)
+      dest[i] = static_cast<char>(source[i]);
+  }
+  if (size > 0)
+    dest[i] = '\0';
+  return AMX_ERR_NONE;
+}
+
+int AMXAPI mock_SetString(cell *dest, const char *source, int, int, size_t size) {
+  size_t i = 0;
+  for (; i + 1 < size && source[i] != '\0'; ++i)
+    dest[i] = static_cast<unsigned char>(source[i]);
+  if (size > 0)
+    dest[i] = 0;
+  return AMX_ERR_NONE;
+}
+
+int AMXAPI mock_FindPublic(AMX *, const char *, int *) {
+  return AMX_ERR_NOTFOUND;
+}
+
+int AMXAPI mock_FindPubVar(AMX *, const char *, cell *) {
+  return AMX_ERR_NOTFOUND;
+}
+
+int AMXAPI mock_NumPublics(AMX *, int *number) {
+  *number = 0;
+  return AMX_ERR_NONE;
+}
+
+int AMXAPI mock_Exec(AMX *, cell *, int) {
+  return AMX_ERR_NOTFOUND;
+}
+
+int AMXAPI mock_Push(AMX *, cell) {
+  return AMX_ERR_NONE;
+}
+
+int AMXAPI mock_RaiseError(AMX *amx, int error) {
+  amx->error = error;
+  return AMX_ERR_NONE;
+}
+
+int AMXAPI mock_GetUserData(AMX *amx, long tag, void **ptr) {
+  for (int i = 0; i < AMX_USERNUM; ++i) {
+    if (amx->usertags[i] == tag) {
+      *ptr = amx->userdata[i];
+      return AMX_ERR_NONE;
+    }
+  }
+  return AMX_ERR_USERDATA;
+}
+
+int AMXAPI mock_SetUserData(AMX *amx, long tag, void *ptr) {
+  for (int i = 0; i < AMX_USERNUM; ++i) {
+    if (amx->usertags[i] == tag || amx->usertags[i] == 0) {
+      amx->usertags[i] = tag;
+      amx->userdata[i] = ptr;
+      return AMX_ERR_NONE;
+    }
+  }
+  return AMX_ERR_USERDATA;
+}
+}
+
+mock_amx::mock_amx(size_t cells) : image(sizeof(AMX_HEADER) + cells * sizeof(cell)), capacity(cells), top(kReservedCells) {
+  auto header = reinterpret_cast<AMX_HEADER *>(image.data());
+  header->size = static_cast<int32_t>(image.size());
+  header->magic = AMX_MAGIC;
+  header->dat = sizeof(AMX_HEADER);
+  header->hea = header->stp = static_cast<int32_t>(image.size());
+  amx.base = image.data();
+  amx.data = image.data() + header->dat;
+  amx.hea = amx.stp = amx.stk = static_cast<cell>(cells * sizeof(cell));
+}
+
+cell mock_amx::allot(size_t cells) {
+  if (top + cells > capacity)
+    throw std::runtime_error{"mock AMX data section exhausted"};
+  auto amx_addr = static_cast<cell>(top * sizeof(cell));
+  std::fill_n(phys(amx_addr), cells, 0);
+  top += cells;
+  return amx_addr;
+}
+
+cell *mock_amx::phys(cell amx_addr) {
+  return reinterpret_cast<cell *>(amx.data + amx_addr);
+}
+
+cell mock_amx::push_string(const std::string &value) {
+  auto amx_addr = allot(value.size() + 1);
+  auto dest = phys(amx_addr);
+  for (size_t i = 0; i < value.size(); ++i)
+    dest[i] = static_cast<unsigned char>(value[i]);
+  return amx_addr;
+}
+
+void **mock_amx::plugin_data(bool quiet) {
+  quiet_log = quiet;
+  amx_exports[PLUGIN_AMX_EXPORT_Register] = reinterpret_cast<void *>(mock_Register);
+  amx_exports[PLUGIN_AMX_EXPORT_GetAddr] = reinterpret_cast<void *>(mock_GetAddr);
+  amx_exports[PLUGIN_AMX_EXPORT_StrLen] = reinterpret_cast<void *>(mock_StrLen);
+  amx_exports[PLUGIN_AMX_EXPORT_GetString] = reinterpret_cast<void *>(mock_GetString);
+  amx_exports[PLUGIN_AMX_EXPORT_SetString] = reinterpret_cast<void *>(mock_SetString);
+  amx_exports[PLUGIN_AMX_EXPORT_FindPublic] = reinterpret_cast<void *>(mock_FindPublic);
+  amx_exports[PLUGIN_AMX_EXPORT_FindPubVar] = reinterpret_cast<void *>(mock_FindPubVar);
+  amx_exports[PLUGIN_AMX_EXPORT_NumPublics] = reinterpret_cast<void *>(mock_NumPublics);
+  amx_exports[PLUGIN_AMX_EXPORT_Exec] = reinterpret_cast<void *>(mock_Exec);
+  amx_exports[PLUGIN_AMX_EXPORT_Push] = reinterpret_cast<void *>(mock_Push);
+  amx_exports[PLUGIN_AMX_EXPORT_RaiseError] = reinterpret_cast<void *>(mock_RaiseError);
+  amx_exports[PLUGIN_AMX_EXPORT_GetUserData] = reinterpret_cast<void *>(mock_GetUserData);
+  amx_exports[PLUGIN_AMX_EXPORT_SetUserData] = reinterpret_cast<void *>(mock_SetUserData);
+  plugin_data_table[PLUGIN_DATA_LOGPRINTF] = reinterpret_cast<void *>(mock_logprintf);
+  plugin_data_table[PLUGIN_DATA_AMX_EXPORTS] = amx_exports.data();
+  return plugin_data_table.data();
+}
+
+AMX_NATIVE mock_amx::find_native(const std::string &name) {
+  auto native = registered_natives.find(name);
+  return native != registered_natives.cend() ? native->second : nullptr;
+}
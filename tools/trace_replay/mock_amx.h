@@ -0,0 +1,58 @@
+// MIT License
+
+// Copyright (c) 2022 Northn
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "common.h"
+
+/**
+ * Minimal AMX instance for running natives outside of the server.
+ * Data section is a flat array of cells; addresses are byte offsets into it.
+ */
+class mock_amx {
+  static constexpr size_t kReservedCells = 16; // keeps address 0 unused, JSON_INVALID_NODE refs stay null
+  std::vector<unsigned char> image;
+  size_t capacity;
+  size_t top;
+  AMX amx{};
+public:
+  explicit mock_amx(size_t cells);
+
+  AMX *get() { return &amx; }
+  cell allot(size_t cells);
+  cell *phys(cell amx_addr);
+  cell push_string(const std::string &value);
+  void reset() { top = kReservedCells; }
+  size_t available() const { return capacity - top; }
+
+  /**
+   * @brief Returns plugin data table for plugin::DoLoad with mocked AMX exports
+   * @param quiet Whether plugin log output should be suppressed
+   */
+  static void **plugin_data(bool quiet);
+  /**
+   * @brief Returns native registered by plugin through amx_Register
+   * @param name Name of native
+   * @return Native function or nullptr if it was not registered
+   */
+  static AMX_NATIVE find_native(const std::string &name);
+};